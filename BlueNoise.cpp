@@ -23,6 +23,9 @@
 #include <core/TellusimLog.h>
 #include <core/TellusimTime.h>
 #include <core/TellusimBlob.h>
+#include <core/TellusimFile.h>
+#include <core/TellusimMemory.h>
+#include <core/TellusimThread.h>
 #include <math/TellusimMath.h>
 
 #include "BlueNoise.h"
@@ -31,6 +34,61 @@
  */
 namespace Tellusim {
 	
+	/*
+	 */
+	class BlueNoise::CheckpointWriter : public Thread {
+			
+		public:
+			
+			CheckpointWriter(const String &name, const Checkpoint &checkpoint) : name(name), checkpoint(checkpoint) { }
+			
+			/// write checkpoint file
+			virtual void process() {
+				
+				// the checkpoint is written to a temporary file and renamed, so a crash keeps the previous one
+				String temp_name = name + ".tmp";
+				File file;
+				if(!file.open(temp_name.get(), "wb")) {
+					TS_LOGF(Error, "BlueNoise::CheckpointWriter::process(): can't create \"%s\" file\n", temp_name.get());
+					return;
+				}
+				
+				// checkpoint header
+				bool status = file.writeu32(CheckpointMagic);
+				status &= file.writeu32(CheckpointVersion);
+				status &= file.writeu32(checkpoint.width);
+				status &= file.writeu32(checkpoint.height);
+				status &= file.writeu32(checkpoint.layers);
+				status &= file.writeu32(checkpoint.phase);
+				status &= file.writeu32(checkpoint.layer);
+				status &= file.writeu32(checkpoint.stored);
+				status &= file.writeu32(checkpoint.jobs.size());
+				
+				// job states
+				for(const CheckpointJob &job : checkpoint.jobs) {
+					status &= file.writeu32(job.num_positions);
+					status &= file.writeu32(job.index);
+					status &= (file.write(job.noise_pattern.get(), job.noise_pattern.size()) == job.noise_pattern.size());
+					status &= (file.write(job.copy_pattern.get(), job.copy_pattern.size()) == job.copy_pattern.size());
+					status &= (file.write(job.sequence.get(), sizeof(uint32_t) * job.sequence.size()) == sizeof(uint32_t) * job.sequence.size());
+					status &= (file.write(job.layers.get(), sizeof(float32_t) * job.layers.size()) == sizeof(float32_t) * job.layers.size());
+				}
+				file.close();
+				
+				// rename checkpoint file
+				if(status && File::isFile(name.get())) File::remove(name.get());
+				if(!status || !File::rename(temp_name.get(), name.get())) {
+					TS_LOGF(Error, "BlueNoise::CheckpointWriter::process(): can't write \"%s\" file\n", name.get());
+					File::remove(temp_name.get());
+				}
+			}
+			
+		private:
+			
+			String name;					// checkpoint name
+			Checkpoint checkpoint;			// checkpoint state
+	};
+	
 	/*
 	 */
 	BlueNoise::BlueNoise() {
@@ -38,408 +96,2165 @@ namespace Tellusim {
 	}
 	
 	BlueNoise::~BlueNoise() {
+		if(checkpoint_writer) {
+			checkpoint_writer->stop();
+			delete checkpoint_writer;
+		}
+	}
+	
+	/*
+	 */
+	void BlueNoise::setEnergyRadius(float32_t radius) {
+		energy_radius = max(radius, 0.0f);
+	}
+	
+	void BlueNoise::setEnergySync(uint32_t sync) {
+		energy_sync = max(sync, 1u);
+	}
+	
+	void BlueNoise::setSelection(uint32_t count, float32_t distance) {
+		select_count = clamp(count, 1u, (uint32_t)MaxSelection);
+		select_distance = max(distance, 0.0f);
+	}
+	
+	void BlueNoise::setCheckpoint(const char *name, float32_t interval) {
+		checkpoint_name = (name) ? String(name) : String();
+		checkpoint_interval = max(interval, 0.0f);
+	}
+	
+	void BlueNoise::setOutputBits(uint32_t bits) {
+		output_bits = (bits == 8 || bits == 16) ? bits : 32;
+	}
+	
+	void BlueNoise::setTileSize(uint32_t size) {
+		tile_size = size;
+	}
+	
+	void BlueNoise::setLayerCallback(const LayerCallback &callback) {
+		layer_callback = callback;
+	}
+	
+	void BlueNoise::setBatchCallback(const BatchCallback &callback) {
+		batch_callback = callback;
+	}
+	
+	void BlueNoise::setStatistics(bool enabled) {
+		statistics_enabled = enabled;
+	}
+	
+	void BlueNoise::setProgressCallback(const ProgressCallback &callback, float32_t interval) {
+		progress_callback = callback;
+		progress_interval = max(interval, 0.0f);
+	}
+	
+	void BlueNoise::setProfile(bool enabled) {
+		profile_enabled = enabled;
+	}
+	
+	const char *BlueNoise::getProfileName(ProfileStage stage) {
+		static const char *names[NumProfileStages] = { "upscale", "forward", "filter", "backward", "sample", "reduce", "update", "energy", "render", "initial", "first", "second", "third" };
+		return (stage < NumProfileStages) ? names[stage] : "unknown";
+	}
+	
+	const char *BlueNoise::getPhaseName(Phase phase) {
+		static const char *names[NumPhases] = { "initial", "first", "second", "third", "render" };
+		return (phase < NumPhases) ? names[phase] : "unknown";
+	}
+	
+	/*
+	 */
+	bool BlueNoise::loadCheckpoint(const char *name) {
+		
+		resume = false;
+		resume_checkpoint = Checkpoint();
+		
+		// open checkpoint file
+		File file;
+		if(!File::isFile(name) || !file.open(name, "rb")) {
+			TS_LOGF(Error, "BlueNoise::loadCheckpoint(): can't open \"%s\" file\n", name);
+			return false;
+		}
 		
+		// checkpoint header
+		if(file.readu32() != CheckpointMagic || file.readu32() != CheckpointVersion) {
+			TS_LOGF(Error, "BlueNoise::loadCheckpoint(): invalid \"%s\" file\n", name);
+			return false;
+		}
+		Checkpoint &checkpoint = resume_checkpoint;
+		checkpoint.width = file.readu32();
+		checkpoint.height = file.readu32();
+		checkpoint.layers = file.readu32();
+		checkpoint.phase = file.readu32();
+		checkpoint.layer = file.readu32();
+		checkpoint.stored = file.readu32();
+		uint32_t num_jobs = file.readu32();
+		if(checkpoint.width < 1 || checkpoint.width > MaxPackedSize || checkpoint.height < 1 || checkpoint.height > MaxPackedSize || checkpoint.phase > PhaseThird || checkpoint.layer >= checkpoint.layers || (checkpoint.stored && checkpoint.stored != checkpoint.layer)) {
+			TS_LOGF(Error, "BlueNoise::loadCheckpoint(): invalid \"%s\" state\n", name);
+			return false;
+		}
+		
+		// check checkpoint size
+		// the jobs and layers are allocated only when the file holds them
+		uint32_t num_pixels = checkpoint.width * checkpoint.height;
+		uint64_t job_size = sizeof(uint32_t) * 2 + (uint64_t)num_pixels * (sizeof(uint8_t) * 2 + sizeof(uint32_t) + sizeof(float32_t) * checkpoint.stored);
+		uint64_t file_size = sizeof(uint32_t) * 9 + job_size * num_jobs;
+		if(!num_jobs || (uint64_t)num_pixels * checkpoint.stored > Maxu32 || file.getSize() != file_size) {
+			TS_LOGF(Error, "BlueNoise::loadCheckpoint(): invalid \"%s\" size\n", name);
+			return false;
+		}
+		
+		// job states
+		bool status = true;
+		checkpoint.jobs.resize(num_jobs);
+		for(CheckpointJob &job : checkpoint.jobs) {
+			job.num_positions = file.readu32();
+			job.index = file.readu32();
+			status &= (job.num_positions <= num_pixels && job.index <= num_pixels);
+			job.noise_pattern.resize(num_pixels);
+			job.copy_pattern.resize(num_pixels);
+			job.sequence.resize(num_pixels);
+			job.layers.resize(num_pixels * checkpoint.stored);
+			status &= (file.read(job.noise_pattern.get(), num_pixels) == num_pixels);
+			status &= (file.read(job.copy_pattern.get(), num_pixels) == num_pixels);
+			status &= (file.read(job.sequence.get(), sizeof(uint32_t) * num_pixels) == sizeof(uint32_t) * num_pixels);
+			status &= (file.read(job.layers.get(), sizeof(float32_t) * job.layers.size()) == sizeof(float32_t) * job.layers.size());
+		}
+		if(!status) {
+			TS_LOGF(Error, "BlueNoise::loadCheckpoint(): can't read \"%s\" file\n", name);
+			resume_checkpoint = Checkpoint();
+			return false;
+		}
+		
+		resume = true;
+		
+		return true;
+	}
+	
+	/*
+	 */
+	bool BlueNoise::flush_readback(const Device &device) {
+		
+		// no pending layer
+		if(readback_layer == Maxu32) return true;
+		
+		// get noise images
+		// the readback buffer stays untouched until the render of the next but one layer
+		uint32_t layer = readback_layer;
+		readback_layer = Maxu32;
+		for(uint32_t i = 0; i < jobs.size(); i++) {
+			Job &job = jobs[i];
+			Buffer &buffer = job.readback_buffers[layer % 2];
+			readback_data.resize((uint32_t)(buffer.getSize() / sizeof(uint32_t)));
+			if(!device.getBuffer(buffer, readback_data.get())) {
+				TS_LOGF(Error, "BlueNoise::flush_readback(): can't get %u noise layer\n", layer);
+				return false;
+			}
+			
+			// copy noise rows
+			// the buffer rows are aligned to words
+			uint32_t height = job.noise_image.getHeight();
+			size_t row_size = (size_t)job.noise_image.getPixelSize() * job.noise_image.getWidth();
+			size_t readback_stride = buffer.getSize() / height;
+			const uint8_t *readback = (const uint8_t*)readback_data.get();
+			ImageSampler noise_sampler(job.noise_image, Layer((layer_callback) ? 0 : layer));
+			uint8_t *noise_data = noise_sampler.getData();
+			size_t noise_stride = noise_sampler.getStride();
+			for(uint32_t y = 0; y < height; y++) {
+				Memory::copy(noise_data + noise_stride * y, readback + readback_stride * y, row_size);
+			}
+			if(layer_callback && !send_layer(i, layer, job.noise_image)) return false;
+		}
+		
+		return true;
+	}
+	
+	/*
+	 */
+	bool BlueNoise::send_layer(uint32_t index, uint32_t layer, const Image &image) {
+		
+		// layer sink
+		if(!layer_callback(index, layer, image)) {
+			TS_LOGF(Error, "BlueNoise::send_layer(): layer sink failed at %u layer of %u image\n", layer, index);
+			return false;
+		}
+		
+		return true;
 	}
 	
 	/*
 	 */
-	bool BlueNoise::create(const Device &device, uint32_t width, uint32_t height, uint32_t layers) {
+	bool BlueNoise::save_checkpoint(const Device &device, Phase phase, uint32_t layer) {
+		
+		// the previous checkpoint is still written
+		if(checkpoint_writer) {
+			if(checkpoint_writer->isRunning()) return true;
+			delete checkpoint_writer;
+			checkpoint_writer = nullptr;
+		}
+		
+		// the readback waits for the submitted batches
+		device.finish();
+		if(!flush_readback(device)) return false;
+		
+		Checkpoint checkpoint;
+		checkpoint.width = jobs[0].noise_image.getWidth();
+		checkpoint.height = jobs[0].noise_image.getHeight();
+		checkpoint.layers = num_layers;
+		checkpoint.phase = phase;
+		checkpoint.layer = layer;
+		checkpoint.stored = (layer_callback) ? 0 : layer;
+		checkpoint.jobs.resize(jobs.size());
+		
+		uint32_t width = checkpoint.width;
+		uint32_t num_pixels = checkpoint.width * checkpoint.height;
+		for(uint32_t i = 0; i < jobs.size(); i++) {
+			Job &job = jobs[i];
+			CheckpointJob &checkpoint_job = checkpoint.jobs[i];
+			checkpoint_job.num_positions = job.num_positions;
+			
+			// the device index is behind the job index after the selection shortfall
+			if(phase >= PhaseSecond && select_count > 1 && !get_iteration(device, job, job.index)) return false;
+			checkpoint_job.index = job.index;
+			
+			// binary noise patterns
+			Image noise_image, copy_image;
+			noise_image.create2D(noise_format, checkpoint.width, checkpoint.height);
+			copy_image.create2D(noise_format, checkpoint.width, checkpoint.height);
+			if(!device.getTexture(job.noise_texture, noise_image) || !device.getTexture(job.copy_texture, copy_image)) {
+				TS_LOG(Warning, "BlueNoise::save_checkpoint(): can't get noise textures\n");
+				return false;
+			}
+			noise_image = noise_image.toFormat(FormatRf32);
+			copy_image = copy_image.toFormat(FormatRf32);
+			const uint8_t *noise_data = noise_image.getData();
+			const uint8_t *copy_data = copy_image.getData();
+			size_t noise_stride = noise_image.getStride();
+			size_t copy_stride = copy_image.getStride();
+			checkpoint_job.noise_pattern.resize(num_pixels);
+			checkpoint_job.copy_pattern.resize(num_pixels);
+			for(uint32_t y = 0; y < checkpoint.height; y++) {
+				const float32_t *noise_row = (const float32_t*)(noise_data + noise_stride * y);
+				const float32_t *copy_row = (const float32_t*)(copy_data + copy_stride * y);
+				uint8_t *noise_pattern = checkpoint_job.noise_pattern.get() + width * y;
+				uint8_t *copy_pattern = checkpoint_job.copy_pattern.get() + width * y;
+				for(uint32_t x = 0; x < width; x++) {
+					noise_pattern[x] = (noise_row[x] > 0.5f) ? 1 : 0;
+					copy_pattern[x] = (copy_row[x] > 0.5f) ? 1 : 0;
+				}
+			}
+			
+			// noise sequence
+			// the sequence buffer is already packed into 16-bit coordinates
+			checkpoint_job.sequence.resize(num_pixels);
+			if(!device.getBuffer(job.sequence_buffer, checkpoint_job.sequence.get())) {
+				TS_LOG(Warning, "BlueNoise::save_checkpoint(): can't get sequence buffer\n");
+				return false;
+			}
+			
+			// finished layers
+			// the layers passed to the sink are not stored
+			checkpoint_job.layers.resize(num_pixels * checkpoint.stored);
+			// the quantized layers are stored as floats
+			for(uint32_t l = 0; l < checkpoint.stored; l++) {
+				Image layer_image = job.noise_image.getSlice(Layer(l)).toFormat(FormatRf32);
+				const uint8_t *layer_data = layer_image.getData();
+				size_t layer_stride = layer_image.getStride();
+				for(uint32_t y = 0; y < checkpoint.height; y++) {
+					Memory::copy(checkpoint_job.layers.get() + num_pixels * l + width * y, layer_data + layer_stride * y, sizeof(float32_t) * width);
+				}
+			}
+		}
+		
+		// write checkpoint
+		checkpoint_writer = new CheckpointWriter(checkpoint_name, checkpoint);
+		if(!checkpoint_writer->run()) {
+			TS_LOG(Warning, "BlueNoise::save_checkpoint(): can't run checkpoint writer\n");
+			delete checkpoint_writer;
+			checkpoint_writer = nullptr;
+			return false;
+		}
+		
+		return true;
+	}
+	
+	/*
+	 */
+	bool BlueNoise::restore_checkpoint(const Device &device, uint32_t width, uint32_t height, uint32_t layers) {
+		
+		// check checkpoint state
+		const Checkpoint &checkpoint = resume_checkpoint;
+		bool status = (checkpoint.width == width && checkpoint.height == height && checkpoint.layers == layers && checkpoint.jobs.size() == jobs.size());
+		if(!layer_callback && checkpoint.stored != checkpoint.layer) status = false;
+		for(uint32_t i = 0; status && i < jobs.size(); i++) {
+			status = (checkpoint.jobs[i].num_positions == jobs[i].num_positions);
+		}
+		if(!status) {
+			TS_LOG(Warning, "BlueNoise::restore_checkpoint(): checkpoint doesn't match the dispatch\n");
+			return false;
+		}
+		
+		uint32_t num_pixels = width * height;
+		for(uint32_t i = 0; i < jobs.size(); i++) {
+			Job &job = jobs[i];
+			const CheckpointJob &checkpoint_job = checkpoint.jobs[i];
+			
+			// binary noise patterns
+			Image noise_image, copy_image;
+			noise_image.create2D(FormatRf32, width, height);
+			copy_image.create2D(FormatRf32, width, height);
+			uint8_t *noise_data = noise_image.getData();
+			uint8_t *copy_data = copy_image.getData();
+			size_t noise_stride = noise_image.getStride();
+			size_t copy_stride = copy_image.getStride();
+			for(uint32_t y = 0; y < height; y++) {
+				float32_t *noise_row = (float32_t*)(noise_data + noise_stride * y);
+				float32_t *copy_row = (float32_t*)(copy_data + copy_stride * y);
+				const uint8_t *noise_pattern = checkpoint_job.noise_pattern.get() + width * y;
+				const uint8_t *copy_pattern = checkpoint_job.copy_pattern.get() + width * y;
+				for(uint32_t x = 0; x < width; x++) {
+					noise_row[x] = (float32_t)noise_pattern[x];
+					copy_row[x] = (float32_t)copy_pattern[x];
+				}
+			}
+			if(!device.setTexture(job.noise_texture, noise_image.toFormat(noise_format)) || !device.setTexture(job.copy_texture, copy_image.toFormat(noise_format))) {
+				TS_LOG(Error, "BlueNoise::restore_checkpoint(): can't set noise textures\n");
+				return false;
+			}
+			
+			// noise sequence
+			// the sequence buffer stores the packed coordinates of all noise pixels
+			if(!device.setBuffer(job.sequence_buffer, checkpoint_job.sequence.get())) {
+				TS_LOG(Error, "BlueNoise::restore_checkpoint(): can't set sequence buffer\n");
+				return false;
+			}
+			
+			// finished layers
+			// the stored layers are passed to the sink again
+			for(uint32_t l = 0; l < checkpoint.stored; l++) {
+				Image layer_image;
+				layer_image.create2D(FormatRf32, width, height);
+				uint8_t *layer_data = layer_image.getData();
+				size_t layer_stride = layer_image.getStride();
+				for(uint32_t y = 0; y < height; y++) {
+					Memory::copy(layer_data + layer_stride * y, checkpoint_job.layers.get() + num_pixels * l + width * y, sizeof(float32_t) * width);
+				}
+				if(!job.noise_image.copy(layer_image.toFormat(job.noise_image.getFormat()), Layer((layer_callback) ? 0 : l))) {
+					TS_LOG(Error, "BlueNoise::restore_checkpoint(): can't restore noise layer\n");
+					return false;
+				}
+				if(layer_callback && !send_layer(i, l, job.noise_image)) return false;
+			}
+		}
+		
+		Log::printf("Resume: layer %u phase %u\n", checkpoint.layer, checkpoint.phase);
+		
+		return true;
+	}
+	
+	/*
+	 */
+	int32_t BlueNoise::compare_resume(Phase phase, uint32_t layer) const {
+		if(!resume) return 1;
+		if(layer != resume_checkpoint.layer) return (layer < resume_checkpoint.layer) ? -1 : 1;
+		if(phase != (Phase)resume_checkpoint.phase) return (phase < (Phase)resume_checkpoint.phase) ? -1 : 1;
+		return 0;
+	}
+	
+	/*
+	 */
+	bool BlueNoise::create(const Device &device, uint32_t width, uint32_t height, uint32_t layers, Flags f, float32_t time) {
+		
+		flags = f;
+		
+		// release pooled resources
+		// the storage formats can change with the flags
+		jobs.clear();
+		convolution_texture.clearPtr();
+		impulse_texture.clearPtr();
+		profile_queries.clear();
+		
+		// batch policy
+		// adaptive batches start small and grow towards the target submission time
+		batch_time = max(time, 0.0f);
+		batch_size = (batch_time > 0.0f) ? (uint32_t)MinBatchSize : (uint32_t)BatchSize;
 		
 		// shader source
 		#include "BlueNoise.blob"
 		String src = Blob(BlueNoise_blob_src).gets();
 		
+		// tiled noise
+		// the tile windows are the largest dispatches, so the transform is sized by the window
+		if(tile_size) {
+			uint32_t window = get_transform_size(tile_size);
+			width = min(width, window);
+			height = min(height, window);
+		}
+		
 		// npot size
 		width = npot(max(width, (uint32_t)MinSize));
 		height = npot(max(height, (uint32_t)MinSize));
 		layers = npot(layers);
 		
+		// storage formats
+		// the binary noise is stored as r8 and the spectrum and energy as fp16 in half precision mode
+		bool half = (flags & FlagHalf);
+		noise_format = (half) ? FormatRu8n : FormatRf32;
+		real_format = (half) ? FormatRf16 : FormatRf32;
+		complex_format = (half) ? FormatRGf16 : FormatRGf32;
+		transform_mode = (half) ? FourierTransform::ModeRf16i : FourierTransform::ModeRf32i;
+		String formats = String::format("NOISE_FORMAT=%s; REAL_FORMAT=%s; COMPLEX_FORMAT=%s", (half) ? "r8" : "r32f", (half) ? "r16f" : "r32f", (half) ? "rg16f" : "rg32f");
+		
 		// create Fourier transform
-		if(!transform.create(device, FourierTransform::ModeRf32i, max(width, layers), max(height, layers))) {
+		transform_width = max(width, layers);
+		transform_height = max(height, layers);
+		if(!transform.create(device, FourierTransform::ModeRf32i, transform_width, transform_height)) {
 			TS_LOG(Error, "BlueNoise::create(): can't create FourierTransform\n");
 			return false;
 		}
 		
+		// create half precision Fourier transform
+		if(half && !half_transform.create(device, FourierTransform::ModeRf16i, width, height)) {
+			TS_LOG(Error, "BlueNoise::create(): can't create half precision FourierTransform\n");
+			return false;
+		}
+		
 		// create inverse kernel
 		inverse_kernel = device.createKernel().setTextures(1).setSurfaces(1);
-		if(!inverse_kernel.createShaderGLSL(src.get(), "INVERSE_SHADER=1; GROUP_SIZE=%u", InverseGroupSize)) return false;
+		if(!inverse_kernel.createShaderGLSL(src.get(), "INVERSE_SHADER=1; GROUP_SIZE=%u; %s", InverseGroupSize, formats.get())) return false;
 		if(!inverse_kernel.create()) return false;
 		
+		// create convolution kernel
+		kernel_kernel = device.createKernel().setSurfaces(1).setUniforms(1).setStorages(1);
+		if(!kernel_kernel.createShaderGLSL(src.get(), "KERNEL_SHADER=1; GROUP_SIZE=%u; %s", KernelGroupSize, formats.get())) return false;
+		if(!kernel_kernel.create()) return false;
+		
+		// create kernel weight reduction kernel
+		weight_kernel = device.createKernel().setUniforms(1).setStorages(1);
+		if(!weight_kernel.createShaderGLSL(src.get(), "WEIGHT_SHADER=1; GROUP_SIZE=%u; %s", WeightGroupSize, formats.get())) return false;
+		if(!weight_kernel.create()) return false;
+		
+		// create spectrum kernel
+		spectrum_kernel = device.createKernel().setTextures(1).setSurfaces(1).setStorages(1);
+		if(!spectrum_kernel.createShaderGLSL(src.get(), "SPECTRUM_SHADER=1; REMOVE_MEAN=%u; GROUP_SIZE=%u; %s", (half) ? 1 : 0, FilterGroupSize, formats.get())) return false;
+		if(!spectrum_kernel.create()) return false;
+		
 		// create filter kernel
-		filter_kernel = device.createKernel().setTextures(2).setSurfaces(1);
-		if(!filter_kernel.createShaderGLSL(src.get(), "FILTER_SHADER=1; GROUP_SIZE=%u", FilterGroupSize)) return false;
+		filter_kernel = device.createKernel().setTextures(1).setSurfaces(1);
+		if(!filter_kernel.createShaderGLSL(src.get(), "FILTER_SHADER=1; GROUP_SIZE=%u; %s", FilterGroupSize, formats.get())) return false;
 		if(!filter_kernel.create()) return false;
 		
+		// create mixed-radix transform kernels
+		mixed_kernel = device.createKernel().setTextures(1).setSurfaces(1).setUniforms(1);
+		mixed_real_kernel = device.createKernel().setTextures(1).setSurfaces(1).setUniforms(1);
+		mixed_filter_kernel = device.createKernel().setTextures(2).setSurfaces(1).setUniforms(1);
+		if(!mixed_kernel.createShaderGLSL(src.get(), "MIXED_SHADER=1; MAX_RADIX=%u; GROUP_SIZE=%u; %s", MaxRadix, MixedGroupSize, formats.get())) return false;
+		if(!mixed_real_kernel.createShaderGLSL(src.get(), "MIXED_SHADER=1; REAL_OUTPUT=1; MAX_RADIX=%u; GROUP_SIZE=%u; %s", MaxRadix, MixedGroupSize, formats.get())) return false;
+		if(!mixed_filter_kernel.createShaderGLSL(src.get(), "MIXED_SHADER=1; FILTER_INPUT=1; MAX_RADIX=%u; GROUP_SIZE=%u; %s", MaxRadix, MixedGroupSize, formats.get())) return false;
+		if(!mixed_kernel.create() || !mixed_real_kernel.create() || !mixed_filter_kernel.create()) return false;
+		
 		// create min sample kernel
 		min_sample_kernel = device.createKernel().setTextures(2).setUniforms(1).setStorages(1);
-		if(!min_sample_kernel.createShaderGLSL(src.get(), "MIN_SAMPLE_SHADER=1; GROUP_SIZE=%u", SampleGroupSize)) return false;
+		if(!min_sample_kernel.createShaderGLSL(src.get(), "MIN_SAMPLE_SHADER=1; GROUP_SIZE=%u; %s", SampleGroupSize, formats.get())) return false;
 		if(!min_sample_kernel.create()) return false;
 		
 		// create max sample kernel
 		max_sample_kernel = device.createKernel().setTextures(2).setUniforms(1).setStorages(1);
-		if(!max_sample_kernel.createShaderGLSL(src.get(), "MAX_SAMPLE_SHADER=1; GROUP_SIZE=%u", SampleGroupSize)) return false;
+		if(!max_sample_kernel.createShaderGLSL(src.get(), "MAX_SAMPLE_SHADER=1; GROUP_SIZE=%u; %s", SampleGroupSize, formats.get())) return false;
 		if(!max_sample_kernel.create()) return false;
 		
+		// create fused sample kernels
+		// subgroup operations finish the global reduction in the sample dispatch
+		const Device::Features &features = device.getFeatures();
+		if(features.subgroupBallot && features.subgroupMath) {
+			min_fused_kernel = device.createKernel().setTextures(2).setUniforms(1).setStorages(2);
+			max_fused_kernel = device.createKernel().setTextures(2).setUniforms(1).setStorages(2);
+			if(!min_fused_kernel.createShaderGLSL(src.get(), "MIN_SAMPLE_SHADER=1; FUSED_SAMPLE=1; GROUP_SIZE=%u; %s", SampleGroupSize, formats.get())) return false;
+			if(!max_fused_kernel.createShaderGLSL(src.get(), "MAX_SAMPLE_SHADER=1; FUSED_SAMPLE=1; GROUP_SIZE=%u; %s", SampleGroupSize, formats.get())) return false;
+			if(!min_fused_kernel.create() || !max_fused_kernel.create()) return false;
+		}
+		
 		// create position reduction kernel
 		position_kernel = device.createKernel().setUniforms(1).setStorages(1);
-		if(!position_kernel.createShaderGLSL(src.get(), "POSITION_SHADER=1; GROUP_SIZE=%u", PositionGroupSize)) return false;
+		if(!position_kernel.createShaderGLSL(src.get(), "POSITION_SHADER=1; GROUP_SIZE=%u; %s", PositionGroupSize, formats.get())) return false;
 		if(!position_kernel.create()) return false;
 		
+		// create position selection kernel
+		candidate_kernel = device.createKernel().setUniforms(1).setStorages(2);
+		if(!candidate_kernel.createShaderGLSL(src.get(), "SELECT_SHADER=1; SELECT_CANDIDATES=1; MAX_CANDIDATES=%u; GROUP_SIZE=%u; %s", MaxCandidates, SelectGroupSize, formats.get())) return false;
+		if(!candidate_kernel.create()) return false;
+		select_kernel = device.createKernel().setUniforms(1).setStorages(3);
+		if(!select_kernel.createShaderGLSL(src.get(), "SELECT_SHADER=1; MAX_CANDIDATES=%u; GROUP_SIZE=%u; %s", MaxCandidates, SelectGroupSize, formats.get())) return false;
+		if(!select_kernel.create()) return false;
+		
 		// create update noise kernel
-		update_kernel = device.createKernel().setSurfaces(1).setUniforms(1).setStorages(2);
-		if(!update_kernel.createShaderGLSL(src.get(), "UPDATE_SHADER=1; GROUP_SIZE=%u", UpdateGroupSize)) return false;
+		update_kernel = device.createKernel().setSurfaces(1).setUniforms(1).setStorages(3);
+		if(!update_kernel.createShaderGLSL(src.get(), "UPDATE_SHADER=1; GROUP_SIZE=%u; %s", UpdateGroupSize, formats.get())) return false;
 		if(!update_kernel.create()) return false;
 		
 		// create render noise kernel
 		render_kernel = device.createKernel().setSurfaces(1).setUniforms(1).setStorages(1);
-		if(!render_kernel.createShaderGLSL(src.get(), "RENDER_SHADER=1; GROUP_SIZE=%u", RenderGroupSize)) return false;
+		if(!render_kernel.createShaderGLSL(src.get(), "RENDER_SHADER=1; GROUP_SIZE=%u; %s", RenderGroupSize, formats.get())) return false;
 		if(!render_kernel.create()) return false;
 		
 		// create layer noise kernel
 		layer_kernel = device.createKernel().setTextures(1).setSurfaces(1).setUniforms(1);
-		if(!layer_kernel.createShaderGLSL(src.get(), "LAYER_SHADER=1; GROUP_SIZE=%u", RenderGroupSize)) return false;
+		if(!layer_kernel.createShaderGLSL(src.get(), "LAYER_SHADER=1; GROUP_SIZE=%u; %s", RenderGroupSize, formats.get())) return false;
 		if(!layer_kernel.create()) return false;
 		
+		// create readback kernels
+		// the output bits are selected by the dispatch, so all kernels are created
+		for(uint32_t i = 0; i < 3; i++) {
+			readback_kernels[i] = device.createKernel().setTextures(1).setStorages(1);
+			if(!readback_kernels[i].createShaderGLSL(src.get(), "READBACK_SHADER=1; OUTPUT_BITS=%u; OUTPUT_SCALE=%s; GROUP_SIZE=%u", 8u << i, (i == 0) ? "255.0f" : "65535.0f", RenderGroupSize)) return false;
+			if(!readback_kernels[i].create()) return false;
+		}
+		
 		// create upscale kernel
-		upscale_kernel = device.createKernel().setTextures(1).setSurfaces(1);
-		if(!upscale_kernel.createShaderGLSL(src.get(), "UPSCALE_SHADER=1; GROUP_SIZE=%u", RenderGroupSize)) return false;
+		upscale_kernel = device.createKernel().setTextures(1).setSurfaces(1).setUniforms(1);
+		if(!upscale_kernel.createShaderGLSL(src.get(), "UPSCALE_SHADER=1; GROUP_SIZE=%u; %s", RenderGroupSize, formats.get())) return false;
 		if(!upscale_kernel.create()) return false;
 		
-		// create noise buffers
-		sequence_buffer = device.createBuffer(Buffer::FlagSource | Buffer::FlagStorage, sizeof(Vector4u) * width * height);
-		position_buffer = device.createBuffer(Buffer::FlagSource | Buffer::FlagStorage, sizeof(Vector4u) * udiv(width, SampleGroupSize) * udiv(height, SampleGroupSize));
-		if(!sequence_buffer || !position_buffer) return false;
+		// create tile kernels
+		halo_kernel = device.createKernel().setTextures(2).setSurfaces(1).setUniforms(1).setStorages(1);
+		if(!halo_kernel.createShaderGLSL(src.get(), "HALO_SHADER=1; GROUP_SIZE=%u; %s", RenderGroupSize, formats.get())) return false;
+		if(!halo_kernel.create()) return false;
+		mask_kernel = device.createKernel().setSurfaces(1).setUniforms(1);
+		if(!mask_kernel.createShaderGLSL(src.get(), "MASK_SHADER=1; GROUP_SIZE=%u; %s", RenderGroupSize, formats.get())) return false;
+		if(!mask_kernel.create()) return false;
+		
+		// create spectrum kernels
+		slice_kernel = device.createKernel().setTextures(1).setSurfaces(1).setUniforms(1);
+		if(!slice_kernel.createShaderGLSL(src.get(), "SLICE_SHADER=1; GROUP_SIZE=%u", RenderGroupSize)) return false;
+		if(!slice_kernel.create()) return false;
+		magnitude_kernel = device.createKernel().setTextures(1).setSurfaces(1).setUniforms(1);
+		if(!magnitude_kernel.createShaderGLSL(src.get(), "MAGNITUDE_SHADER=1; GROUP_SIZE=%u", RenderGroupSize)) return false;
+		if(!magnitude_kernel.create()) return false;
+		
+		// create energy update kernel
+		if(flags & FlagIncremental) {
+			energy_kernel = device.createKernel().setTextures(1).setSurfaces(1).setUniforms(1).setStorages(2);
+			if(!energy_kernel.createShaderGLSL(src.get(), "ENERGY_SHADER=1; GROUP_SIZE=%u; %s", EnergyGroupSize, formats.get())) return false;
+			if(!energy_kernel.create()) return false;
+		}
+		
+		// create batch queries
+		if(batch_time > 0.0f) {
+			for(uint32_t i = 0; i < NumBatchQueries; i++) {
+				batch_queries[i].query = device.createQuery(Query::TypeTime);
+				if(!batch_queries[i].query) {
+					TS_LOG(Warning, "BlueNoise::create(): can't create batch query\n");
+					batch_time = 0.0f;
+					batch_size = BatchSize;
+					break;
+				}
+			}
+		}
 		
 		return true;
 	}
 	
 	/*
 	 */
-	bool BlueNoise::dispatch_kernel(const Device &device, Compute &compute, Texture &texture, Kernel &kernel, float32_t value, uint32_t index) {
+	bool BlueNoise::create_job(const Device &device, Job &job, const Image &image, uint32_t width, uint32_t height, uint32_t layers) {
 		
-		Texture noise_texture = texture;
+		uint32_t transform_width = get_transform_size(width);
+		uint32_t transform_height = get_transform_size(height);
+		bool mixed = (volume_layers > 1 || !ispot(transform_width) || !ispot(transform_height));
 		
-		// upscale kernel
-		if(texture.getSize() != backward_texture.getSize()) {
-			compute.setKernel(upscale_kernel);
-			compute.setTexture(0, texture);
-			compute.setSurfaceTexture(0, upscale_texture);
-			compute.dispatch(upscale_texture);
-			compute.barrier(upscale_texture);
-			noise_texture = upscale_texture;
+		// create noise image
+		// the image is returned to the caller, so it is never reused
+		// the layer sink keeps only the current layer
+		if(layer_callback) layers = 1;
+		Format output_format = (output_bits == 8) ? FormatRu8n : (output_bits == 16) ? FormatRu16n : FormatRf32;
+		if(!job.noise_image.create2D(output_format, width, height, layers)) {
+			TS_LOG(Error, "BlueNoise::create_job(): can't create noise image\n");
+			return false;
+		}
+		
+		// create readback buffers
+		// the output rows are packed into words, so the size changes with the output bits
+		size_t readback_size = sizeof(uint32_t) * udiv(width, 32 / output_bits) * height;
+		if(!job.readback_buffers[0] || job.readback_buffers[0].getSize() != readback_size) {
+			job.readback_buffers[0] = device.createBuffer(Buffer::FlagSource | Buffer::FlagStorage, readback_size);
+			job.readback_buffers[1] = device.createBuffer(Buffer::FlagSource | Buffer::FlagStorage, readback_size);
+			if(!job.readback_buffers[0] || !job.readback_buffers[1]) {
+				TS_LOG(Error, "BlueNoise::create_job(): can't create readback buffers\n");
+				return false;
+			}
+		}
+		
+		// reuse job resources
+		// all job resources depend only on the image size
+		if(job.noise_texture && job.noise_texture.getWidth() == width && job.noise_texture.getHeight() == height) {
+			if(!device.setTexture(job.noise_texture, image.toFormat(noise_format))) {
+				TS_LOG(Error, "BlueNoise::create_job(): can't update noise texture\n");
+				return false;
+			}
+			return true;
+		}
+		
+		// create noise texture
+		job.noise_texture = device.createTexture(image.toFormat(noise_format), Texture::FlagSource | Texture::FlagSurface);
+		if(!job.noise_texture) {
+			TS_LOG(Error, "BlueNoise::create_job(): can't create noise texture\n");
+			return false;
+		}
+		
+		// create textures
+		job.copy_texture = device.createTexture2D(noise_format, width, height, Texture::FlagSource | Texture::FlagSurface);
+		job.layer_texture = device.createTexture2D(FormatRf32, width, height, Texture::FlagSource | Texture::FlagSurface);
+		job.forward_texture = device.createTexture2D(complex_format, (mixed) ? transform_width : transform_width / 2 + 1, transform_height, Texture::FlagSource | Texture::FlagSurface);
+		job.backward_texture = device.createTexture2D(real_format, transform_width, transform_height, Texture::FlagSource | Texture::FlagSurface);
+		if(!job.copy_texture || !job.layer_texture || !job.forward_texture || !job.backward_texture) {
+			TS_LOG(Error, "BlueNoise::create_job(): can't create textures\n");
+			return false;
+		}
+		
+		// create mixed-radix transform texture
+		// the transform passes alternate between the forward and the transform textures
+		job.transform_texture.clearPtr();
+		if(mixed) {
+			job.transform_texture = device.createTexture2D(complex_format, transform_width, transform_height, Texture::FlagSurface);
+			if(!job.transform_texture) {
+				TS_LOG(Error, "BlueNoise::create_job(): can't create transform texture\n");
+				return false;
+			}
+		}
+		
+		// create upscale texture
+		if(job.noise_texture.getSize() != job.backward_texture.getSize() || input_scale != 1.0f) {
+			job.upscale_texture = device.createTexture2D(real_format, transform_width, transform_height, Texture::FlagSurface);
+			if(!job.upscale_texture) {
+				TS_LOG(Error, "BlueNoise::create_job(): can't create upscale texture\n");
+				return false;
+			}
+		}
+		
+		// create noise buffers
+		// the sequence stores a packed coordinate per noise pixel, and the positions store the packed coordinate and the weight key
+		job.sequence_buffer = device.createBuffer(Buffer::FlagSource | Buffer::FlagStorage, sizeof(uint32_t) * width * height);
+		job.position_buffer = device.createBuffer(Buffer::FlagSource | Buffer::FlagStorage, sizeof(Vector2u) * udiv(transform_width, SampleGroupSize) * udiv(transform_height, SampleGroupSize));
+		job.select_buffer = device.createBuffer(Buffer::FlagStorage, sizeof(Vector2u) * MaxSelection);
+		job.candidate_buffer = device.createBuffer(Buffer::FlagStorage, sizeof(Vector2u) * MaxCandidates);
+		job.iteration_buffer = device.createBuffer(Buffer::FlagSource | Buffer::FlagStorage, sizeof(IterationState));
+		job.converged_buffers[0] = device.createBuffer(Buffer::FlagSource | Buffer::FlagStorage, sizeof(IterationState));
+		job.converged_buffers[1] = device.createBuffer(Buffer::FlagSource | Buffer::FlagStorage, sizeof(IterationState));
+		if(!job.sequence_buffer || !job.position_buffer || !job.select_buffer || !job.candidate_buffer || !job.iteration_buffer || !job.converged_buffers[0] || !job.converged_buffers[1]) {
+			TS_LOG(Error, "BlueNoise::create_job(): can't create buffers\n");
+			return false;
+		}
+		
+		// create counter buffer
+		// the last sample group resets the counter after the reduction
+		if(min_fused_kernel) {
+			uint32_t counter = 0;
+			job.counter_buffer = device.createBuffer(Buffer::FlagStorage, &counter, sizeof(counter));
+			if(!job.counter_buffer) {
+				TS_LOG(Error, "BlueNoise::create_job(): can't create counter buffer\n");
+				return false;
+			}
 		}
 		
+		return true;
+	}
+	
+	/*
+	 */
+	bool BlueNoise::dispatch_energy(Compute &compute, Job &job, Texture &dest, Texture &src) {
+		
+		FourierTransform &energy_transform = (flags & FlagHalf) ? half_transform : transform;
+		bool mixed = (bool)job.transform_texture;
+		
 		// forward transform
-		if(!transform.dispatch(compute, FourierTransform::ModeRf32i, FourierTransform::ForwardRtoC, forward_textures[0], noise_texture)) {
-			TS_LOG(Error, "BlueNoise::dispatch_kernel(): can't dispatch forward transform\n");
+		uint32_t query = begin_profile(compute, ProfileForward, profile_sample);
+		if((mixed) ? !dispatch_mixed(compute, job, job.forward_texture, src, true) : !energy_transform.dispatch(compute, transform_mode, FourierTransform::ForwardRtoC, job.forward_texture, src)) {
+			TS_LOG(Error, "BlueNoise::dispatch_energy(): can't dispatch forward transform\n");
 			return false;
 		}
+		end_profile(compute, query);
 		
-		// filter pass
-		compute.setKernel(filter_kernel);
-		compute.setTextures(0, { forward_textures[0], convolution_texture });
-		compute.setSurfaceTexture(0, forward_textures[1]);
-		compute.dispatch(forward_textures[1]);
-		compute.barrier(forward_textures[1]);
+		// in-place filter pass
+		// the mixed-radix transform filters the spectrum in its first backward pass
+		if(!mixed) {
+			query = begin_profile(compute, ProfileFilter, profile_sample);
+			compute.setKernel(filter_kernel);
+			compute.setTexture(0, convolution_texture);
+			compute.setSurfaceTexture(0, job.forward_texture);
+			compute.dispatch(job.forward_texture);
+			compute.barrier(job.forward_texture);
+			end_profile(compute, query);
+		}
 		
 		// backward transform
-		if(!transform.dispatch(compute, FourierTransform::ModeRf32i, FourierTransform::BackwardCtoR, backward_texture, forward_textures[1])) {
-			TS_LOG(Error, "BlueNoise::dispatch_kernel(): can't dispatch backward transform\n");
+		query = begin_profile(compute, ProfileBackward, profile_sample);
+		if((mixed) ? !dispatch_mixed(compute, job, dest, job.forward_texture, false, true) : !energy_transform.dispatch(compute, transform_mode, FourierTransform::BackwardCtoR, dest, job.forward_texture)) {
+			TS_LOG(Error, "BlueNoise::dispatch_energy(): can't dispatch backward transform\n");
 			return false;
 		}
+		end_profile(compute, query);
+		
+		return true;
+	}
+	
+	/*
+	 */
+	bool BlueNoise::is_transform_size(uint32_t size) {
+		
+		// the size has only 2, 3, 5 and 7 factors
+		static const uint32_t radices[] = { 2, 3, 5, 7 };
+		if(size == 0) return false;
+		for(uint32_t radix : radices) {
+			while(size % radix == 0) size /= radix;
+		}
+		
+		return (size == 1);
+	}
+	
+	uint32_t BlueNoise::get_transform_size(uint32_t size) {
+		
+		size = max(size, (uint32_t)MinSize);
+		if(ispot(size)) return size;
+		
+		// the smallest mixed-radix size
+		while(!is_transform_size(size)) size++;
+		
+		return size;
+	}
+	
+	bool BlueNoise::get_forward_transform(const Device &device, uint32_t width, uint32_t height, FourierTransform &forward_transform) {
+		
+		// the created transform covers the size
+		if(width <= transform_width && height <= transform_height) {
+			forward_transform = transform;
+			return true;
+		}
+		
+		// the transform of the tiled noise covers only the tile window, so the whole image uses a temporary transform
+		if(!forward_transform.create(device, FourierTransform::ModeRf32i, width, height)) {
+			TS_LOG(Error, "BlueNoise::get_forward_transform(): can't create FourierTransform\n");
+			return false;
+		}
+		
+		return true;
+	}
+	
+	/*
+	 */
+	bool BlueNoise::dispatch_mixed(Compute &compute, Job &job, Texture &dest, Texture &src, bool forward, bool filter) {
+		
+		// transform passes
+		// every pass is a single Stockham radix step along the rows, the columns or the stacked volume layers
+		struct Pass {
+			uint32_t axis;
+			uint32_t radix;
+			uint32_t stride;
+			uint32_t size;
+			uint32_t spacing;
+		};
+		
+		static const uint32_t radices[] = { 8, 7, 5, 4, 3, 2 };
+		uint32_t sizes[2] = { job.backward_texture.getWidth(), job.backward_texture.getHeight() };
+		uint32_t lines[3][3] = { { 0, sizes[0], 1 }, { 1, sizes[1] / volume_layers, 1 }, { 1, volume_layers, sizes[1] / volume_layers } };
+		Pass passes[96];
+		uint32_t num_passes = 0;
+		for(const uint32_t (&line)[3] : lines) {
+			uint32_t size = line[1];
+			uint32_t stride = 1;
+			for(uint32_t radix : radices) {
+				while(size % radix == 0) {
+					passes[num_passes++] = { line[0], radix, stride, line[1], line[2] };
+					stride *= radix;
+					size /= radix;
+				}
+			}
+			if(size != 1) {
+				TS_LOGF(Error, "BlueNoise::dispatch_mixed(): invalid transform size %u\n", line[1]);
+				return false;
+			}
+		}
+		
+		// pass textures
+		// the forward transform ends in the forward texture and the backward transform in the destination texture
+		auto get_texture = [&](uint32_t index) -> Texture& {
+			if(forward) return ((num_passes - index) % 2) ? job.forward_texture : job.transform_texture;
+			if(index == num_passes - 1) return dest;
+			return (index % 2) ? job.forward_texture : job.transform_texture;
+		};
+		
+		// mixed parameters
+		struct MixedParameters {
+			uint32_t axis;
+			uint32_t radix;
+			uint32_t stride;
+			uint32_t size;
+			uint32_t spacing;
+			float32_t direction;
+			float32_t scale;
+		};
+		
+		for(uint32_t i = 0; i < num_passes; i++) {
+			const Pass &pass = passes[i];
+			
+			// the last backward pass normalizes the real output
+			// the first backward pass filters the spectrum
+			bool real = (!forward && i == num_passes - 1);
+			bool filtered = (filter && !forward && i == 0);
+			
+			MixedParameters mixed_parameters;
+			mixed_parameters.axis = pass.axis;
+			mixed_parameters.radix = pass.radix;
+			mixed_parameters.stride = pass.stride;
+			mixed_parameters.size = pass.size;
+			mixed_parameters.spacing = pass.spacing;
+			mixed_parameters.direction = (forward) ? -1.0f : 1.0f;
+			mixed_parameters.scale = (real) ? 1.0f / ((float32_t)sizes[0] * sizes[1]) : 1.0f;
+			
+			// dispatch transform pass
+			Texture &texture = get_texture(i);
+			compute.setKernel((real) ? mixed_real_kernel : (filtered) ? mixed_filter_kernel : mixed_kernel);
+			compute.setUniform(0, mixed_parameters);
+			if(filtered) compute.setTextures(0, { src, convolution_texture });
+			else compute.setTexture(0, (i) ? get_texture(i - 1) : src);
+			compute.setSurfaceTexture(0, texture);
+			if(pass.axis == 0) compute.dispatch(sizes[0] / pass.radix, sizes[1]);
+			else compute.dispatch(sizes[0], sizes[1] / pass.radix);
+			compute.barrier(texture);
+		}
+		
+		return true;
+	}
+	
+	/*
+	 */
+	uint32_t BlueNoise::get_select_count(uint32_t remain, uint32_t empty) const {
+		
+		// every sample group provides a single candidate, so the number of groups with
+		// an empty pixel bounds the number of distinct positions available for selection
+		uint32_t count = min(select_size, remain);
+		count = min(count, empty / (SampleGroupSize * SampleGroupSize));
+		
+		return max(count, 1u);
+	}
+	
+	/*
+	 */
+	bool BlueNoise::set_iteration(const Device &device, Job &job, uint32_t index, int32_t step) {
+		
+		IterationState iteration_state = {};
+		iteration_state.index = index;
+		iteration_state.step = step;
+		iteration_state.inserted = Maxu32;
+		
+		// the sequence index advances on the device
+		if(!device.setBuffer(job.iteration_buffer, &iteration_state)) {
+			TS_LOG(Error, "BlueNoise::set_iteration(): can't set iteration buffer\n");
+			return false;
+		}
+		
+		// full energy update on the next iteration
+		job.energy_index = 0;
+		
+		return true;
+	}
+	
+	bool BlueNoise::get_iteration(const Device &device, Job &job, uint32_t &index) {
+		
+		IterationState iteration_state = {};
+		if(!device.getBuffer(job.iteration_buffer, &iteration_state)) {
+			TS_LOG(Error, "BlueNoise::get_iteration(): can't get iteration buffer\n");
+			return false;
+		}
+		index = iteration_state.index;
+		
+		return true;
+	}
+	
+	bool BlueNoise::is_converged(const Device &device, Job &job, uint32_t batch, bool &converged) {
+		
+		// the flag is written by the update kernel and copied at the end of every batch
+		// the buffer readback is blocking and can synchronize with the submitted batch, the delayed copy only keeps the previous state stable
+		IterationState iteration_state = {};
+		if(!device.getBuffer(job.converged_buffers[batch % 2], &iteration_state)) {
+			TS_LOG(Error, "BlueNoise::is_converged(): can't get iteration buffer\n");
+			return false;
+		}
+		converged = (iteration_state.converged != 0);
+		
+		return true;
+	}
+	
+	/*
+	 */
+	bool BlueNoise::dispatch_kernel(const Device &device, Compute &compute, Job &job, Texture &texture, Phase phase, Sample sample, float32_t value, uint32_t count) {
+		
+		Texture noise_texture = texture;
+		Texture source_texture = texture;
+		float32_t threshold = 0.5f;
+		
+		// full energy update
+		// the incremental energy is synchronized periodically to bound the truncation and precision drift
+		bool full_energy = (!energy_size || job.energy_index++ % energy_sync == 0);
+		
+		// profile sample
+		// only every ProfileInterval-th kernel is measured to keep the query overhead low
+		profile_sample = (profile_enabled && profile_index++ % ProfileInterval == 0);
+		
+		// tile halo kernel
+		// the halo pass replaces the upscale pass, it sets the halo pixels from the ranks of the neighbour tiles
+		bool resize = (texture.getSize() != job.backward_texture.getSize());
+		if(job.tile_texture) {
+			
+			// halo parameters
+			struct HaloParameters {
+				Vector4u core;
+				float32_t scale;
+				uint32_t num_pixels;
+				uint32_t num_positions;
+				int32_t invert;
+			};
+			
+			HaloParameters halo_parameters = {};
+			halo_parameters.core = tile_core;
+			halo_parameters.scale = input_scale;
+			halo_parameters.num_pixels = tile_core.z * tile_core.w;
+			halo_parameters.num_positions = job.num_positions;
+			halo_parameters.invert = (phase == PhaseThird) ? 1 : 0;
+			
+			// dispatch halo kernel
+			uint32_t query = begin_profile(compute, ProfileUpscale, profile_sample);
+			compute.setKernel(halo_kernel);
+			compute.setUniform(0, halo_parameters);
+			compute.setStorageBuffer(0, job.iteration_buffer);
+			compute.setTextures(0, { texture, job.tile_texture });
+			compute.setSurfaceTexture(0, job.upscale_texture);
+			compute.dispatch(job.upscale_texture);
+			compute.barrier(job.upscale_texture);
+			end_profile(compute, query);
+			source_texture = job.upscale_texture;
+		}
+		// upscale kernel
+		// the upscale pass also scales the transform input in half precision mode
+		else if(resize || (full_energy && input_scale != 1.0f)) {
+			uint32_t query = begin_profile(compute, ProfileUpscale, profile_sample);
+			compute.setKernel(upscale_kernel);
+			compute.setUniform(0, input_scale);
+			compute.setTexture(0, texture);
+			compute.setSurfaceTexture(0, job.upscale_texture);
+			compute.dispatch(job.upscale_texture);
+			compute.barrier(job.upscale_texture);
+			end_profile(compute, query);
+			source_texture = job.upscale_texture;
+			if(resize) {
+				noise_texture = job.upscale_texture;
+				threshold *= input_scale;
+			}
+		}
+		
+		// full energy update
+		if(full_energy && !dispatch_energy(compute, job, job.backward_texture, source_texture)) return false;
+		
+		// tile halo mask
+		// the halo pixels are never sampled, they belong to the neighbour tiles
+		if(job.tile_texture) {
+			
+			// mask parameters
+			struct MaskParameters {
+				Vector4u core;
+				float32_t value;
+			};
+			
+			MaskParameters mask_parameters = {};
+			mask_parameters.core = tile_core;
+			mask_parameters.value = (sample == SampleMin) ? 6e4f : -6e4f;
+			
+			// dispatch mask kernel
+			uint32_t query = begin_profile(compute, ProfileUpscale, profile_sample);
+			compute.setKernel(mask_kernel);
+			compute.setUniform(0, mask_parameters);
+			compute.setSurfaceTexture(0, job.backward_texture);
+			compute.dispatch(job.backward_texture);
+			compute.barrier(job.backward_texture);
+			end_profile(compute, query);
+		}
 		
 		// sample parameters
-		uint32_t num_groups = udiv(noise_texture.getWidth(), SampleGroupSize);
-		
-		// dispatch sample kernel
-		compute.setKernel(kernel);
-		compute.setUniform(0, num_groups);
-		compute.setStorageBuffer(0, position_buffer);
-		compute.setTextures(0, { noise_texture, backward_texture });
-		compute.dispatch(noise_texture);
-		compute.barrier(position_buffer);
-		
-		// position parameters
-		uint32_t num_positions = num_groups * udiv(noise_texture.getHeight(), SampleGroupSize);
-		
-		// dispatch reduction kernel
-		compute.setKernel(position_kernel);
-		compute.setUniform(0, num_positions);
-		compute.setStorageBuffer(0, position_buffer);
-		compute.dispatch(1);
-		compute.barrier(position_buffer);
+		struct SampleParameters {
+			uint32_t num_groups;
+			float32_t threshold;
+		};
+		
+		SampleParameters sample_parameters = {};
+		sample_parameters.num_groups = udiv(noise_texture.getWidth(), SampleGroupSize);
+		sample_parameters.threshold = threshold;
+		uint32_t num_positions = sample_parameters.num_groups * udiv(noise_texture.getHeight(), SampleGroupSize);
+		
+		// fused reduction
+		// the selection requires all group positions
+		Buffer buffer = job.position_buffer;
+		if(count == 1 && min_fused_kernel) {
+			
+			// dispatch fused sample kernel
+			uint32_t query = begin_profile(compute, ProfileSample, profile_sample);
+			compute.setKernel((sample == SampleMin) ? min_fused_kernel : max_fused_kernel);
+			compute.setUniform(0, sample_parameters);
+			compute.setStorageBuffers(0, { job.position_buffer, job.counter_buffer });
+			compute.setTextures(0, { noise_texture, job.backward_texture });
+			compute.dispatch(noise_texture);
+			compute.barrier(job.position_buffer);
+			end_profile(compute, query);
+		}
+		else {
+			
+			// dispatch sample kernel
+			uint32_t query = begin_profile(compute, ProfileSample, profile_sample);
+			compute.setKernel((sample == SampleMin) ? min_sample_kernel : max_sample_kernel);
+			compute.setUniform(0, sample_parameters);
+			compute.setStorageBuffer(0, job.position_buffer);
+			compute.setTextures(0, { noise_texture, job.backward_texture });
+			compute.dispatch(noise_texture);
+			compute.barrier(job.position_buffer);
+			end_profile(compute, query);
+			
+			// single position
+			query = begin_profile(compute, ProfileReduce, profile_sample);
+			if(count == 1) {
+				
+				// dispatch reduction kernel
+				compute.setKernel(position_kernel);
+				compute.setUniform(0, num_positions);
+				compute.setStorageBuffer(0, job.position_buffer);
+				compute.dispatch(1);
+				compute.barrier(job.position_buffer);
+			}
+			// multiple positions
+			else {
+				
+				// select parameters
+				struct SelectParameters {
+					Vector2u texture_size;
+					uint32_t num_positions;
+					uint32_t count;
+					float32_t radius;
+					uint32_t group_candidates;
+				};
+				
+				// the candidate groups keep at most MaxCandidates best positions
+				uint32_t num_groups = min(udiv(num_positions, SelectGroupSize), (uint32_t)MaxCandidates);
+				
+				SelectParameters select_parameters = {};
+				select_parameters.texture_size = Vector2u(noise_texture.getWidth(), noise_texture.getHeight());
+				select_parameters.num_positions = num_positions;
+				select_parameters.count = count;
+				select_parameters.radius = select_radius;
+				select_parameters.group_candidates = clamp((uint32_t)MaxCandidates / num_groups, 1u, count);
+				
+				// dispatch candidate kernel
+				// every group sorts its positions in parallel and keeps the best candidates
+				compute.setKernel(candidate_kernel);
+				compute.setUniform(0, select_parameters);
+				compute.setStorageBuffers(0, { job.position_buffer, job.candidate_buffer });
+				compute.dispatch(num_groups);
+				compute.barrier(job.candidate_buffer);
+				
+				// dispatch selection kernel
+				// the separation is relaxed only over the candidates
+				select_parameters.num_positions = num_groups * select_parameters.group_candidates;
+				compute.setKernel(select_kernel);
+				compute.setUniform(0, select_parameters);
+				compute.setStorageBuffers(0, { job.candidate_buffer, job.select_buffer, job.iteration_buffer });
+				compute.dispatch(1);
+				compute.barrier({ job.select_buffer, job.iteration_buffer });
+				buffer = job.select_buffer;
+			}
+			end_profile(compute, query);
+		}
 		
 		// update parameters
 		struct UpdateParameters {
 			Vector2u texture_size;
 			float32_t value;
-			uint32_t index;
+			uint32_t count;
 		};
 		
 		UpdateParameters update_parameters = {};
 		update_parameters.texture_size = Vector2u(noise_texture.getWidth(), noise_texture.getHeight());
 		update_parameters.value = value;
-		update_parameters.index = index;
+		update_parameters.count = count;
+		
+		// dispatch update kernel
+		uint32_t query = begin_profile(compute, ProfileUpdate, profile_sample);
+		compute.setKernel(update_kernel);
+		compute.setUniform(0, update_parameters);
+		compute.setStorageBuffers(0, { job.sequence_buffer, buffer, job.iteration_buffer });
+		compute.setSurfaceTexture(0, texture);
+		compute.dispatch(count);
+		compute.barrier(texture);
+		end_profile(compute, query);
+		
+		// incremental energy update
+		// selected positions can share the kernel footprint, so they are applied sequentially
+		// the kernels after the committed selection count are skipped on the device
+		if(energy_size) {
+			
+			// energy parameters
+			struct EnergyParameters {
+				uint32_t size;
+				float32_t value;
+				uint32_t index;
+				uint32_t count;
+			};
+			
+			EnergyParameters energy_parameters = {};
+			energy_parameters.size = energy_size;
+			energy_parameters.value = value;
+			energy_parameters.count = count;
+			
+			// dispatch energy kernel
+			query = begin_profile(compute, ProfileEnergy, profile_sample);
+			compute.setKernel(energy_kernel);
+			for(uint32_t i = 0; i < count; i++) {
+				energy_parameters.index = i;
+				compute.setUniform(0, energy_parameters);
+				compute.setStorageBuffers(0, { buffer, job.iteration_buffer });
+				compute.setTexture(0, impulse_texture);
+				compute.setSurfaceTexture(0, job.backward_texture);
+				compute.dispatch(energy_size, energy_size);
+				compute.barrier(job.backward_texture);
+			}
+			end_profile(compute, query);
+		}
+		profile_sample = false;
+		
+		return true;
+	}
+	
+	/*
+	 */
+	bool BlueNoise::dispatch_phase(const Device &device, Phase phase, uint32_t layer, uint32_t num_pixels, uint32_t progress) {
+		
+		// phase sequence
+		// the phase length depends on the number of initial positions of each job
+		// a resumed phase continues from the checkpoint iteration
+		bool done = true;
+		bool resumed = (compare_resume(phase, layer) == 0);
+		uint32_t half_pixels = num_pixels / 2;
+		for(uint32_t i = 0; i < jobs.size(); i++) {
+			Job &job = jobs[i];
+			if(phase == PhaseInitial || phase == PhaseFirst) {
+				job.index = 0;
+				job.end = job.num_positions;
+			} else if(phase == PhaseSecond) {
+				job.index = job.num_positions;
+				job.end = half_pixels;
+			} else {
+				job.index = half_pixels;
+				job.end = num_pixels;
+			}
+			if(resumed) job.index = max(job.index, resume_checkpoint.jobs[i].index);
+			if(phase == PhaseInitial && !set_iteration(device, job, Maxu32, 0)) return false;
+			if(phase == PhaseFirst && !set_iteration(device, job, job.end - 1 - job.index, -1)) return false;
+			if(phase >= PhaseSecond && !set_iteration(device, job, job.index, 1)) return false;
+			done &= (job.index >= job.end);
+		}
+		if(resumed) {
+			resume_checkpoint = Checkpoint();
+			resume = false;
+		}
+		
+		// the initial sequence runs two kernels per position
+		uint32_t scale = (phase == PhaseInitial) ? 2 : 1;
+		uint32_t num_batches = 0;
+		progress_phase = phase;
+		progress_layer = layer;
+		
+		// phase statistics
+		Statistics &phase_statistics = statistics[phase];
+		uint64_t statistics_time = 0;
+		if(statistics_enabled) {
+			device.finish();
+			statistics_time = Time::current();
+		}
+		
+		while(!done) {
+			uint32_t current = 0;
+			uint32_t iterations = 0;
+			{
+				Compute compute = device.createCompute();
+				
+				// the batch query is reused after its result is read back
+				BatchQuery &batch_query = batch_queries[batch_index % NumBatchQueries];
+				bool query = (batch_query.query && !batch_query.iterations && compute.beginQuery(batch_query.query));
+				
+				// the phase batches are always measured
+				uint32_t phase_query = begin_profile(compute, (ProfileStage)(ProfileInitial + phase), true);
+				
+				// dispatch iterations
+				// every iteration advances all unfinished jobs
+				// the kernels of every iteration are recorded on the host, only the sequence index lives on the device
+				for(; iterations < batch_size && !done; iterations++) {
+					done = true;
+					for(Job &job : jobs) {
+						if(job.index >= job.end) continue;
+						Texture &texture = (phase == PhaseFirst || phase == PhaseThird) ? job.copy_texture : job.noise_texture;
+						if(phase == PhaseInitial) {
+							if(!dispatch_kernel(device, compute, job, texture, phase, SampleMin, 1.0f)) return false;
+							if(!dispatch_kernel(device, compute, job, texture, phase, SampleMax, 0.0f)) return false;
+							phase_statistics.kernels += 2;
+							phase_statistics.iterations++;
+							job.index++;
+						} else if(phase == PhaseFirst) {
+							if(!dispatch_kernel(device, compute, job, texture, phase, SampleMax, 0.0f)) return false;
+							phase_statistics.kernels++;
+							phase_statistics.iterations++;
+							job.index++;
+						} else {
+							uint32_t count = get_select_count(job.end - job.index, num_pixels - job.index);
+							if(phase == PhaseSecond && !dispatch_kernel(device, compute, job, texture, phase, SampleMin, 1.0f, count)) return false;
+							if(phase == PhaseThird && !dispatch_kernel(device, compute, job, texture, phase, SampleMax, 0.0f, count)) return false;
+							phase_statistics.kernels++;
+							phase_statistics.iterations += count;
+							job.index += count;
+						}
+						done &= (job.index >= job.end);
+					}
+				}
+				
+				// phase progress
+				current = progress;
+				for(const Job &job : jobs) {
+					current += job.index * scale;
+				}
+				
+				// copy iteration state
+				// the convergence flag is read back one batch later
+				if(phase == PhaseInitial) {
+					for(Job &job : jobs) {
+						if(job.index >= job.end) continue;
+						compute.barrier(job.iteration_buffer);
+						compute.copyBuffer(job.converged_buffers[num_batches % 2], job.iteration_buffer);
+					}
+				}
+				
+				// batch query
+				end_profile(compute, phase_query);
+				if(query) {
+					compute.endQuery(batch_query.query);
+					batch_query.iterations = iterations;
+					batch_query.progress = current;
+					batch_index++;
+				}
+			}
+			device.flip();
+			
+			// initial sequence convergence
+			// the state of the previous batch is checked, so the early exit is at most one batch late
+			// the converged jobs are finished, and the remaining swaps of the batches don't change the pattern
+			if(phase == PhaseInitial && !done && num_batches) {
+				done = true;
+				for(Job &job : jobs) {
+					bool converged = false;
+					if(job.index < job.end && !is_converged(device, job, num_batches - 1, converged)) return false;
+					if(converged) job.index = job.end;
+					done &= (job.index >= job.end);
+				}
+			}
+			
+			// selection shortfall
+			// the job indices are ahead of the device when the selection commits fewer positions, so the phase continues from the device index
+			if(phase >= PhaseSecond && done && select_count > 1) {
+				for(Job &job : jobs) {
+					if(!get_iteration(device, job, job.index)) return false;
+					done &= (job.index >= job.end);
+				}
+			}
+			num_batches++;
+			
+			// batch progress
+			update_batches();
+			update_profile();
+			if(batch_time > 0.0f) current = batch_progress;
+			update_progress(current);
+			
+			// save checkpoint
+			// a failed checkpoint doesn't stop the generation
+			if(checkpoint_name && checkpoint_interval > 0.0f && !done && Time::current() - checkpoint_time > (uint64_t)(checkpoint_interval * Time::Seconds)) {
+				save_checkpoint(device, phase, layer);
+				checkpoint_time = Time::current();
+			}
+			
+			// batch callback
+			// the canceled dispatch keeps its checkpoint
+			if(!done && batch_callback && !batch_callback()) {
+				TS_LOG(Warning, "BlueNoise::dispatch_phase(): dispatch is canceled\n");
+				return false;
+			}
+		}
+		
+		// phase time
+		if(statistics_enabled) {
+			device.finish();
+			phase_statistics.time += Time::current() - statistics_time;
+		}
+		
+		return true;
+	}
+	
+	/*
+	 */
+	void BlueNoise::update_batches() {
+		
+		for(uint32_t i = 0; i < NumBatchQueries; i++) {
+			BatchQuery &batch_query = batch_queries[i];
+			if(!batch_query.iterations || !batch_query.query.isAvailable()) continue;
+			
+			// iteration time
+			float64_t time = (float64_t)batch_query.query.getTime() / batch_query.iterations;
+			
+			// resize batch to the target submission time
+			if(time > 0.0) {
+				float64_t size = batch_time * 1e6 / time;
+				size = (size + batch_size) * 0.5;
+				batch_size = (uint32_t)clamp(size, (float64_t)MinBatchSize, (float64_t)MaxBatchSize);
+			}
+			
+			batch_progress = max(batch_progress, batch_query.progress);
+			batch_query.iterations = 0;
+		}
+	}
+	
+	/*
+	 */
+	uint32_t BlueNoise::begin_profile(Compute &compute, ProfileStage stage, bool sample) {
+		
+		if(!profile_enabled) return Maxu32;
+		profiles[stage].count++;
+		if(!sample) return Maxu32;
+		
+		// free query
+		// the stage is not measured when all queries are pending
+		for(uint32_t i = 0; i < profile_queries.size(); i++) {
+			ProfileQuery &profile_query = profile_queries[i];
+			if(profile_query.pending) continue;
+			if(!compute.beginQuery(profile_query.query)) return Maxu32;
+			profile_query.stage = stage;
+			profile_query.pending = true;
+			return i;
+		}
 		
-		// dispatch update kernel
-		compute.setKernel(update_kernel);
-		compute.setUniform(0, update_parameters);
-		compute.setStorageBuffers(0, { sequence_buffer, position_buffer });
-		compute.setSurfaceTexture(0, texture);
-		compute.dispatch(1);
-		compute.barrier(texture);
+		return Maxu32;
+	}
+	
+	void BlueNoise::end_profile(Compute &compute, uint32_t index) {
+		if(index != Maxu32) compute.endQuery(profile_queries[index].query);
+	}
+	
+	void BlueNoise::update_profile() {
 		
-		return true;
+		for(ProfileQuery &profile_query : profile_queries) {
+			if(!profile_query.pending || !profile_query.query.isAvailable()) continue;
+			
+			// stage time in milliseconds
+			Profile &profile = profiles[profile_query.stage];
+			profile.time += (float64_t)profile_query.query.getTime() / 1e6;
+			profile.samples++;
+			profile_query.pending = false;
+		}
 	}
 	
 	/*
 	 */
 	Image BlueNoise::dispatch(const Device &device, const Image &image, uint32_t layers, float32_t sigma, float32_t epsilon) {
 		
+		Array<Image> noise_images = dispatch(device, Array<Image>({ image }), layers, sigma, epsilon);
+		if(!noise_images) return Image();
+		
+		return noise_images[0];
+	}
+	
+	Array<Image> BlueNoise::dispatch(const Device &device, const Array<Image> &images, uint32_t layers, float32_t sigma, float32_t epsilon) {
+		
+		// check images
+		if(!images) {
+			TS_LOG(Error, "BlueNoise::dispatch(): no images\n");
+			return Array<Image>();
+		}
+		
 		// check image size
-		uint32_t width = image.getWidth();
-		uint32_t height = image.getHeight();
+		uint32_t width = images[0].getWidth();
+		uint32_t height = images[0].getHeight();
 		if(width < 1 || height < 1 || layers < 1) {
 			TS_LOGF(Error, "BlueNoise::dispatch(): invalid image size %ux%u l%u\n", width, height, layers);
-			return Image();
+			return Array<Image>();
+		}
+		for(const Image &image : images) {
+			if(image.getWidth() != width || image.getHeight() != height) {
+				TS_LOGF(Error, "BlueNoise::dispatch(): image size mismatch %ux%u %ux%u\n", image.getWidth(), image.getHeight(), width, height);
+				return Array<Image>();
+			}
 		}
 		
-		// npot size
-		uint32_t npot_width = max(npot(width), (uint32_t)MinSize);
-		uint32_t npot_height = max(npot(height), (uint32_t)MinSize);
+		// tiled noise
+		// every tile window is generated by a separate dispatch
+		if(tile_size && !tile_core.z) return dispatch_tiles(device, images, layers, sigma, epsilon);
+		
+		// volume noise
+		// all layers are generated by a single dispatch of the stacked layers
+		if((flags & FlagVolume) && layers > 1) return dispatch_volume(device, images, layers, sigma, epsilon);
+		
+		// transform size
+		// the sequence and position records are packed into 16-bit coordinates
+		uint32_t transform_width = get_transform_size(width);
+		uint32_t transform_height = get_transform_size(height);
+		if(transform_width > MaxPackedSize || transform_height > MaxPackedSize) {
+			TS_LOGF(Error, "BlueNoise::dispatch(): invalid transform size %ux%u\n", transform_width, transform_height);
+			return Array<Image>();
+		}
 		
 		// current time
 		uint64_t begin = Time::current();
 		
-		// create input image
-		Image input_image = image.toFormat(FormatRf32);
-		if(!input_image) {
-			TS_LOG(Error, "BlueNoise::dispatch(): can't create noise image\n");
-			return Image();
-		}
+		// transform input scale
+		// the scaled input keeps the half precision spectrum in range
+		input_scale = (flags & FlagHalf) ? 1.0f / transform_width : 1.0f;
 		
-		// number of positions
-		uint32_t num_positions = 0;
-		ImageSampler input_samper(input_image);
-		for(uint32_t y = 0; y < height; y++) {
-			for(uint32_t x = 0; x < width; x++) {
-				ImageColor pixel = input_samper.get2D(x, y);
-				if(pixel.f.r > 0.5f) {
-					pixel.f.r = 1.0f;
-					num_positions++;
-				} else {
-					pixel.f.r = 0.0f;
-				}
-				input_samper.set2D(x, y, pixel);
-			}
+		// create jobs
+		// the jobs of the previous dispatch are kept as a resource pool
+		readback_layer = Maxu32;
+		num_layers = layers;
+		for(Statistics &phase_statistics : statistics) {
+			phase_statistics = Statistics();
 		}
 		
-		// create noise image
-		Image noise_image;
-		if(!noise_image.create2D(FormatRf32, width, height, layers)) {
-			TS_LOG(Error, "BlueNoise::dispatch(): can't create noise image\n");
-			return Image();
+		// profile queries
+		// the queries are created by the first profiled dispatch
+		for(Profile &profile : profiles) {
+			profile = Profile();
 		}
-		
-		// create noise texture
-		Texture noise_texture = device.createTexture(input_image, Texture::FlagSource | Texture::FlagSurface);
-		if(!noise_texture) {
-			TS_LOG(Error, "BlueNoise::dispatch(): can't create noise texture\n");
-			return Image();
+		profile_index = 0;
+		profile_sample = false;
+		for(uint32_t i = profile_queries.size(); profile_enabled && i < NumProfileQueries; i++) {
+			ProfileQuery profile_query;
+			profile_query.query = device.createQuery(Query::TypeTime);
+			if(!profile_query.query) {
+				TS_LOG(Warning, "BlueNoise::dispatch(): can't create profile query\n");
+				profile_queries.clear();
+				profile_enabled = false;
+				break;
+			}
+			profile_queries.append(profile_query);
 		}
-		
-		// create texture
-		Texture copy_texture = device.createTexture2D(FormatRf32, width, height, Texture::FlagSource | Texture::FlagSurface);
-		Texture layer_texture = device.createTexture2D(FormatRf32, width, height, Texture::FlagSource | Texture::FlagSurface);
-		if(!copy_texture || !layer_texture) {
-			TS_LOG(Error, "BlueNoise::dispatch(): can't create textures\n");
-			return Image();
+		for(ProfileQuery &profile_query : profile_queries) {
+			profile_query.pending = false;
 		}
-		
-		// create kernel image
-		Image kernel_image;
-		kernel_image.create2D(FormatRf32, npot_width, npot_height);
-		ImageSampler kernel_sampler(kernel_image);
-		
-		// generate Gaussian kernel
-		float64_t weight = 0.0;
-		float32_t isigma = 1.0f / (sigma * sigma + 1e-6f);
-		for(uint32_t y0 = 0; y0 < npot_height / 2; y0++) {
-			uint32_t y1 = npot_height - 1 - y0;
-			float32_t dy0 = (float32_t)y0;
-			float32_t dy1 = dy0 + 1.0f;
-			for(uint32_t x0 = 0; x0 < npot_width / 2; x0++) {
-				uint32_t x1 = npot_width - 1 - x0;
-				float32_t dx0 = (float32_t)x0;
-				float32_t dx1 = dx0 + 1.0f;
-				float32_t d00 = dx0 * dx0 + dy0 * dy0;
-				float32_t d10 = dx1 * dx1 + dy0 * dy0;
-				float32_t d01 = dx0 * dx0 + dy1 * dy1;
-				float32_t d11 = dx1 * dx1 + dy1 * dy1;
-				float32_t k00 = exp(-d00 * isigma) + epsilon / (1.0f + d00);
-				float32_t k10 = exp(-d10 * isigma) + epsilon / (1.0f + d10);
-				float32_t k01 = exp(-d01 * isigma) + epsilon / (1.0f + d01);
-				float32_t k11 = exp(-d11 * isigma) + epsilon / (1.0f + d11);
-				kernel_sampler.set2D(x0, y0, ImageColor(k00));
-				kernel_sampler.set2D(x1, y0, ImageColor(k10));
-				kernel_sampler.set2D(x0, y1, ImageColor(k01));
-				kernel_sampler.set2D(x1, y1, ImageColor(k11));
-				weight += k00 + k01 + k10 + k11;
-			}
-		}
-		float32_t iweight = (float32_t)(npot_width / weight);
-		for(uint32_t y = 0; y < npot_height; y++) {
-			for(uint32_t x = 0; x < npot_width; x++) {
-				ImageColor pixel = kernel_sampler.get2D(x, y);
-				pixel.f.r *= iweight;
-				kernel_sampler.set2D(x, y, pixel);
-			}
-		}
-		
-		// create kernel texture
-		Texture kernel_texture = device.createTexture(kernel_image);
-		if(!kernel_texture) {
-			TS_LOG(Error, "BlueNoise::dispatch(): can't create kernel texture\n");
-			return Image();
+		jobs.resize(images.size());
+		for(uint32_t i = 0; i < images.size(); i++) {
+			Job &job = jobs[i];
+			job.num_positions = 0;
+			
+			// create input image
+			Image input_image = images[i].toFormat(FormatRf32);
+			if(!input_image) {
+				TS_LOG(Error, "BlueNoise::dispatch(): can't create input image\n");
+				return Array<Image>();
+			}
+			
+			// number of positions
+			// the branchless row loop is vectorized by the compiler
+			uint8_t *input_data = input_image.getData();
+			size_t input_stride = input_image.getStride();
+			for(uint32_t y = 0; y < height; y++) {
+				float32_t *row = (float32_t*)(input_data + input_stride * y);
+				uint32_t num_positions = 0;
+				for(uint32_t x = 0; x < width; x++) {
+					uint32_t position = (row[x] > 0.5f) ? 1 : 0;
+					row[x] = (float32_t)position;
+					num_positions += position;
+				}
+				job.num_positions += num_positions;
+			}
+			
+			// create job resources
+			// a partially created job is released, so it's never reused
+			if(!create_job(device, job, input_image, width, height, layers)) {
+				job = Job();
+				return Array<Image>();
+			}
+			
+			// tile halo ranks
+			// the halo kernel writes the transform input, so the tiled window always has the upscale texture
+			if(!tile_core.z) {
+				job.tile_texture.clearPtr();
+				continue;
+			}
+			if(!job.upscale_texture) job.upscale_texture = device.createTexture2D(real_format, transform_width, transform_height, Texture::FlagSurface);
+			if(!job.tile_texture || job.tile_texture.getWidth() != width || job.tile_texture.getHeight() != height) job.tile_texture = device.createTexture(tile_images[i]);
+			else if(!device.setTexture(job.tile_texture, tile_images[i])) job.tile_texture.clearPtr();
+			if(!job.upscale_texture || !job.tile_texture) {
+				TS_LOG(Error, "BlueNoise::dispatch(): can't create tile textures\n");
+				job = Job();
+				return Array<Image>();
+			}
 		}
 		
-		// create convolution texture
-		convolution_texture = device.createTexture2D(FormatRGf32, npot_width / 2 + 1, npot_height, Texture::FlagSource | Texture::FlagSurface);
-		{
-			Compute compute = device.createCompute();
-			if(!convolution_texture || !transform.dispatch(compute, FourierTransform::ModeRf32i, FourierTransform::ForwardRtoC, convolution_texture, kernel_texture)) {
+		// shared resources are created with the first job scratch textures
+		Job &first_job = jobs[0];
+		
+		// reuse convolution texture
+		// the kernel spectrum depends only on the size and the kernel parameters
+		bool convolution = (convolution_texture && convolution_width == transform_width && convolution_height == transform_height && convolution_layers == volume_layers && convolution_sigma == sigma && convolution_epsilon == epsilon);
+		if(!convolution) {
+			
+			// create kernel texture
+			// the kernel is generated on the device, and the group weights are reduced into the normalization weight
+			uint32_t num_weights = udiv(transform_width, KernelGroupSize) * udiv(transform_height, KernelGroupSize);
+			Texture kernel_texture = device.createTexture2D(real_format, transform_width, transform_height, Texture::FlagSurface);
+			Buffer weight_buffer = device.createBuffer(Buffer::FlagStorage, sizeof(float32_t) * num_weights);
+			if(!kernel_texture || !weight_buffer) {
+				TS_LOG(Error, "BlueNoise::dispatch(): can't create kernel texture\n");
+				return Array<Image>();
+			}
+			
+			// create convolution texture
+			// the wrap-around kernel is symmetric, so its spectrum is real
+			convolution_texture = device.createTexture2D(real_format, first_job.forward_texture.getWidth(), transform_height, Texture::FlagSource | Texture::FlagSurface);
+			if(!convolution_texture) {
 				TS_LOG(Error, "BlueNoise::dispatch(): can't create convolution texture\n");
-				return Image();
+				return Array<Image>();
+			}
+			{
+				Compute compute = device.createCompute();
+				
+				// kernel parameters
+				struct KernelParameters {
+					float32_t isigma;
+					float32_t epsilon;
+					uint32_t layers;
+				};
+				
+				KernelParameters kernel_parameters;
+				kernel_parameters.isigma = 1.0f / (sigma * sigma + 1e-6f);
+				kernel_parameters.epsilon = epsilon;
+				kernel_parameters.layers = volume_layers;
+				
+				// dispatch convolution kernel
+				compute.setKernel(kernel_kernel);
+				compute.setUniform(0, kernel_parameters);
+				compute.setStorageBuffer(0, weight_buffer);
+				compute.setSurfaceTexture(0, kernel_texture);
+				compute.dispatch(kernel_texture);
+				compute.barrier(weight_buffer);
+				compute.barrier(kernel_texture);
+				
+				// weight parameters
+				struct WeightParameters {
+					uint32_t num_weights;
+					float32_t scale;
+				};
+				
+				WeightParameters weight_parameters;
+				weight_parameters.num_weights = num_weights;
+				weight_parameters.scale = (float32_t)transform_width;
+				
+				// dispatch weight reduction kernel
+				compute.setKernel(weight_kernel);
+				compute.setUniform(0, weight_parameters);
+				compute.setStorageBuffer(0, weight_buffer);
+				compute.dispatch(1);
+				compute.barrier(weight_buffer);
+				
+				// forward kernel transform
+				FourierTransform &energy_transform = (flags & FlagHalf) ? half_transform : transform;
+				bool mixed = (bool)first_job.transform_texture;
+				if((mixed) ? !dispatch_mixed(compute, first_job, first_job.forward_texture, kernel_texture, true) : !energy_transform.dispatch(compute, transform_mode, FourierTransform::ForwardRtoC, first_job.forward_texture, kernel_texture)) {
+					TS_LOG(Error, "BlueNoise::dispatch(): can't create convolution texture\n");
+					return Array<Image>();
+				}
+				
+				// normalized kernel spectrum
+				compute.setKernel(spectrum_kernel);
+				compute.setStorageBuffer(0, weight_buffer);
+				compute.setTexture(0, first_job.forward_texture);
+				compute.setSurfaceTexture(0, convolution_texture);
+				compute.dispatch(convolution_texture);
+				compute.barrier(convolution_texture);
 			}
+			
+			convolution_width = transform_width;
+			convolution_height = transform_height;
+			convolution_layers = volume_layers;
+			convolution_sigma = sigma;
+			convolution_epsilon = epsilon;
+			impulse_texture.clearPtr();
 		}
 		
-		// create forward textures
-		forward_textures[0] = device.createTexture2D(FormatRGf32, npot_width / 2 + 1, npot_height, Texture::FlagSource | Texture::FlagSurface);
-		forward_textures[1] = device.createTexture2D(FormatRGf32, npot_width / 2 + 1, npot_height, Texture::FlagSource | Texture::FlagSurface);
-		if(!forward_textures[0] || !forward_textures[1]) {
-			TS_LOG(Error, "BlueNoise::dispatch(): can't create forward textures\n");
-			return Image();
+		// incremental energy footprint
+		// the wrap-around padding replicates pixels, so the local update requires unpadded transform sizes
+		energy_size = 0;
+		if(flags & FlagIncremental) {
+			if(volume_layers > 1) {
+				TS_LOG(Warning, "BlueNoise::dispatch(): incremental energy is not supported by volume noise\n");
+			} else if(first_job.noise_texture.getSize() == first_job.backward_texture.getSize()) {
+				uint32_t radius = (uint32_t)ceil(sigma * energy_radius);
+				energy_size = min(radius * 2 + 1, min(transform_width, transform_height) - 1);
+			} else {
+				TS_LOGF(Warning, "BlueNoise::dispatch(): incremental energy requires 2-3-5-7 size %ux%u\n", width, height);
+			}
 		}
 		
-		// create backward texture
-		backward_texture = device.createTexture2D(FormatRf32, npot_width, npot_height, Texture::FlagSource | Texture::FlagSurface);
-		if(!backward_texture) {
-			TS_LOG(Error, "BlueNoise::dispatch(): can't create backward textures\n");
-			return Image();
+		// create impulse texture
+		// the impulse response of the full energy update keeps both update paths at the same scale
+		if(energy_size && !impulse_texture) {
+			Image impulse_image;
+			impulse_image.create2D(FormatRf32, transform_width, transform_height);
+			ImageSampler impulse_sampler(impulse_image);
+			impulse_sampler.set2D(0, 0, ImageColor(input_scale));
+			Texture delta_texture = device.createTexture(impulse_image.toFormat(real_format));
+			impulse_texture = device.createTexture2D(real_format, transform_width, transform_height, Texture::FlagSource | Texture::FlagSurface);
+			Compute compute = device.createCompute();
+			if(!delta_texture || !impulse_texture || !dispatch_energy(compute, first_job, impulse_texture, delta_texture)) {
+				TS_LOG(Error, "BlueNoise::dispatch(): can't create impulse texture\n");
+				return Array<Image>();
+			}
 		}
 		
-		// create upscale texture
-		if(noise_texture.getSize() != backward_texture.getSize()) {
-			upscale_texture = device.createTexture2D(FormatRf32, npot_width, npot_height, Texture::FlagSurface);
-			if(!upscale_texture) {
-				TS_LOG(Error, "BlueNoise::dispatch(): can't create upscale textures\n");
-				return Image();
+		// multiple selection
+		// the selection distance is measured on the texture torus, so it requires unpadded transform sizes
+		select_size = 1;
+		select_radius = sigma * select_distance;
+		if(select_count > 1) {
+			if(volume_layers > 1) {
+				TS_LOG(Warning, "BlueNoise::dispatch(): multiple selection is not supported by volume noise\n");
+			} else if(first_job.noise_texture.getSize() == first_job.backward_texture.getSize()) {
+				select_size = select_count;
+			} else {
+				TS_LOGF(Warning, "BlueNoise::dispatch(): multiple selection requires 2-3-5-7 size %ux%u\n", width, height);
 			}
 		}
 		
 		// create initial sequence
-		uint32_t num_pixels = width * height;
-		uint32_t half_pixels = num_pixels / 2;
-		uint32_t progress_pixels = num_positions * 2 + num_pixels * layers;
-		for(uint32_t i = 0; i < num_positions;) {
-			{
-				Compute compute = device.createCompute();
-				for(uint32_t end = min(i + BatchSize, num_positions); i < end; i++) {
-					dispatch_kernel(device, compute, noise_texture, min_sample_kernel, 1.0f, Maxu32);
-					dispatch_kernel(device, compute, noise_texture, max_sample_kernel, 0.0f, Maxu32);
-				}
-			}
-			device.flip();
-			print_progress((uint32_t)(i * 2 * 10000ull / progress_pixels), begin);
+		// the tiled window generates only the core pixels
+		uint32_t num_pixels = (tile_core.z) ? tile_core.z * tile_core.w : width * height;
+		uint32_t num_positions = 0;
+		for(const Job &job : jobs) {
+			num_positions += job.num_positions;
+		}
+		progress_pixels = num_positions * 2 + num_pixels * layers * jobs.size();
+		progress_time = begin;
+		batch_progress = 0;
+		
+		// resume checkpoint
+		if(resume && !restore_checkpoint(device, width, height, layers)) {
+			resume_checkpoint = Checkpoint();
+			resume = false;
 		}
+		checkpoint_time = Time::current();
+		if(compare_resume(PhaseInitial, 0) >= 0 && !dispatch_phase(device, PhaseInitial, 0, num_pixels, 0)) return Array<Image>();
 		
 		// create noise layers
-		for(uint32_t l = 0, progress = num_positions * 2; l < layers; l++, progress += num_pixels) {
+		for(uint32_t l = 0, progress = num_positions * 2; l < layers; l++, progress += num_pixels * jobs.size()) {
+			
+			// finished layers are restored from the checkpoint
+			if(compare_resume(PhaseThird, l) < 0) continue;
 			
 			// first phase
-			device.copyTexture(copy_texture, noise_texture);
-			for(uint32_t i = 0; i < num_positions;) {
-				{
-					Compute compute = device.createCompute();
-					for(uint32_t end = min(i + BatchSize, num_positions); i < end; i++) {
-						dispatch_kernel(device, compute, copy_texture, max_sample_kernel, 0.0f, num_positions - i - 1);
-					}
+			if(compare_resume(PhaseFirst, l) > 0) {
+				for(Job &job : jobs) {
+					device.copyTexture(job.copy_texture, job.noise_texture);
 				}
-				device.flip();
-				print_progress((uint32_t)((progress + i) * 10000ull / progress_pixels), begin);
 			}
+			if(compare_resume(PhaseFirst, l) >= 0 && !dispatch_phase(device, PhaseFirst, l, num_pixels, progress)) return Array<Image>();
 			
 			// second phase
-			for(uint32_t i = num_positions; i < half_pixels;) {
-				{
-					Compute compute = device.createCompute();
-					for(uint32_t end = min(i + BatchSize, half_pixels); i < end; i++) {
-						dispatch_kernel(device, compute, noise_texture, min_sample_kernel, 1.0f, i);
-					}
-				}
-				device.flip();
-				print_progress((uint32_t)((progress + i) * 10000ull / progress_pixels), begin);
-			}
+			if(compare_resume(PhaseSecond, l) >= 0 && !dispatch_phase(device, PhaseSecond, l, num_pixels, progress)) return Array<Image>();
 			
 			// third phase
-			{
+			if(compare_resume(PhaseThird, l) > 0) {
 				Compute compute = device.createCompute();
 				compute.setKernel(inverse_kernel);
-				compute.setTexture(0, noise_texture);
-				compute.setSurfaceTexture(0, copy_texture);
-				compute.dispatch(copy_texture);
-				compute.barrier(copy_texture);
-			}
-			for(uint32_t i = half_pixels; i < num_pixels;) {
-				{
-					Compute compute = device.createCompute();
-					for(uint32_t end = min(i + BatchSize, num_pixels); i < end; i++) {
-						dispatch_kernel(device, compute, copy_texture, max_sample_kernel, 0.0f, i);
-					}
+				for(Job &job : jobs) {
+					compute.setTexture(0, job.noise_texture);
+					compute.setSurfaceTexture(0, job.copy_texture);
+					compute.dispatch(job.copy_texture);
+					compute.barrier(job.copy_texture);
 				}
-				device.flip();
-				print_progress((uint32_t)((progress + i) * 10000ull / progress_pixels), begin);
 			}
+			if(!dispatch_phase(device, PhaseThird, l, num_pixels, progress)) return Array<Image>();
+			
+			// render statistics
+			uint64_t statistics_time = Time::current();
 			
 			// render noise
 			{
 				Compute compute = device.createCompute();
+				uint32_t query = begin_profile(compute, ProfileRender, true);
 				compute.setKernel(render_kernel);
-				compute.setUniform(0, image.getSize());
-				compute.setStorageBuffer(0, sequence_buffer);
-				compute.setSurfaceTexture(0, layer_texture);
-				compute.dispatch(layer_texture);
-				compute.barrier(layer_texture);
+				for(Job &job : jobs) {
+					Vector2u size = (tile_core.z) ? Vector2u(tile_core.z, tile_core.w) : Vector2u(width, height);
+					compute.setUniform(0, size);
+					compute.setStorageBuffer(0, job.sequence_buffer);
+					compute.setSurfaceTexture(0, job.layer_texture);
+					compute.dispatch(size.x, size.y);
+					compute.barrier(job.layer_texture);
+				}
+				end_profile(compute, query);
+			}
+			
+			// copy noise
+			// the ranks are quantized and packed into the readback buffer of the layer
+			{
+				Compute compute = device.createCompute();
+				compute.setKernel(readback_kernels[(output_bits == 8) ? 0 : (output_bits == 16) ? 1 : 2]);
+				for(Job &job : jobs) {
+					compute.setStorageBuffer(0, job.readback_buffers[l % 2]);
+					compute.setTexture(0, job.layer_texture);
+					compute.dispatch(udiv(job.layer_texture.getWidth(), 32 / output_bits), job.layer_texture.getHeight());
+					compute.barrier(job.readback_buffers[l % 2]);
+				}
 			}
 			
 			// next layer
 			if(l + 1 < layers) {
 				Compute compute = device.createCompute();
 				compute.setKernel(layer_kernel);
-				compute.setUniform(0, (float32_t)num_positions / (float32_t)num_pixels);
-				compute.setTexture(0, layer_texture);
-				compute.setSurfaceTexture(0, noise_texture);
-				compute.dispatch(noise_texture);
-				compute.barrier(noise_texture);
+				for(Job &job : jobs) {
+					compute.setUniform(0, (float32_t)job.num_positions / (float32_t)num_pixels);
+					compute.setTexture(0, job.layer_texture);
+					compute.setSurfaceTexture(0, job.noise_texture);
+					compute.dispatch(job.noise_texture);
+					compute.barrier(job.noise_texture);
+				}
 			}
 			
-			// finish device
-			device.finish();
+			// the layer is read back one layer later
+			// the buffer copy of the previous layer is complete behind the batches of this layer
+			if(!flush_readback(device)) return Array<Image>();
+			readback_layer = l;
 			
-			// get noise image
-			device.getTexture(layer_texture, Layer(0), noise_image, Layer(l));
+			// render time
+			// the readback of the previous layer is included
+			if(statistics_enabled) {
+				device.finish();
+				uint32_t num_kernels = 2 + ((l + 1 < layers) ? 1 : 0);
+				statistics[PhaseRender].kernels += jobs.size() * num_kernels;
+				statistics[PhaseRender].iterations += jobs.size();
+				statistics[PhaseRender].time += Time::current() - statistics_time;
+			}
+		}
+		
+		// get the last noise layer
+		device.finish();
+		if(!flush_readback(device)) return Array<Image>();
+		update_profile();
+		
+		// remove checkpoint
+		// the finished dispatch doesn't need its checkpoint anymore
+		if(checkpoint_writer) {
+			checkpoint_writer->stop();
+			delete checkpoint_writer;
+			checkpoint_writer = nullptr;
 		}
+		if(checkpoint_name && File::isFile(checkpoint_name.get())) File::remove(checkpoint_name.get());
 		
 		// done
-		print_progress(10000, begin);
-		Log::print("\n");
+		update_progress(progress_pixels, true);
+		
+		// noise images
+		Array<Image> noise_images;
+		for(Job &job : jobs) {
+			noise_images.append(job.noise_image);
+			job.noise_image.clear();
+		}
+		
+		return noise_images;
+	}
+	
+	/*
+	 */
+	Image BlueNoise::mergeChannels(const Array<Image> &images) {
+		
+		// check channels
+		if(!images || images.size() > 4) {
+			TS_LOGF(Error, "BlueNoise::mergeChannels(): invalid number of channels %u\n", images.size());
+			return Image();
+		}
+		const Image &image = images[0];
+		for(const Image &channel_image : images) {
+			if(channel_image.getFormat() != image.getFormat() || channel_image.getSize() != image.getSize()) {
+				TS_LOG(Error, "BlueNoise::mergeChannels(): channel format mismatch\n");
+				return Image();
+			}
+		}
+		
+		// channels format
+		Format format = FormatUnknown;
+		if(image.getFormat() == FormatRu8n) format = FormatRGBAu8n;
+		else if(image.getFormat() == FormatRu16n) format = FormatRGBAu16n;
+		else if(image.getFormat() == FormatRf32) format = FormatRGBAf32;
+		else {
+			TS_LOG(Error, "BlueNoise::mergeChannels(): invalid channel format\n");
+			return Image();
+		}
+		
+		// create channels image
+		uint32_t width = image.getWidth();
+		uint32_t height = image.getHeight();
+		uint32_t layers = image.getLayers();
+		Image channels_image;
+		if((layers) ? !channels_image.create2D(format, width, height, layers) : !channels_image.create2D(format, width, height)) {
+			TS_LOG(Error, "BlueNoise::mergeChannels(): can't create channels image\n");
+			return Image();
+		}
+		
+		// interleave channels
+		size_t component_size = image.getPixelSize();
+		for(uint32_t l = 0; l < max(layers, 1u); l++) {
+			ImageSampler channels_sampler = (layers) ? ImageSampler(channels_image, Layer(l)) : ImageSampler(channels_image);
+			uint8_t *channels_data = channels_sampler.getData();
+			size_t channels_stride = channels_sampler.getStride();
+			for(uint32_t c = 0; c < 4; c++) {
+				ImageSampler sampler;
+				if(c < images.size()) sampler = (layers) ? ImageSampler(images[c], Layer(l)) : ImageSampler(images[c]);
+				const uint8_t *data = (c < images.size()) ? sampler.getData() : nullptr;
+				size_t stride = (data) ? sampler.getStride() : 0;
+				for(uint32_t y = 0; y < height; y++) {
+					uint8_t *dest = channels_data + channels_stride * y + component_size * c;
+					const uint8_t *src = (data) ? data + stride * y : nullptr;
+					for(uint32_t x = 0; x < width; x++) {
+						for(size_t i = 0; i < component_size; i++) {
+							dest[component_size * 4 * x + i] = (src) ? src[component_size * x + i] : 0;
+						}
+					}
+				}
+			}
+		}
+		
+		return channels_image;
+	}
+	
+	/*
+	 */
+	Array<Image> BlueNoise::dispatch_volume(const Device &device, const Array<Image> &images, uint32_t layers, float32_t sigma, float32_t epsilon) {
+		
+		// check volume size
+		// the layers are stacked without padding, so every dimension must be a transform size
+		uint32_t width = images[0].getWidth();
+		uint32_t height = images[0].getHeight();
+		if(get_transform_size(width) != width || get_transform_size(height) != height || !is_transform_size(layers)) {
+			TS_LOGF(Error, "BlueNoise::dispatch_volume(): invalid volume size %ux%ux%u\n", width, height, layers);
+			return Array<Image>();
+		}
+		
+		// create stacked images
+		// the layered input provides every layer, the single layer input is repeated with a different offset in every layer
+		Array<Image> stack_images;
+		for(const Image &image : images) {
+			Image input_image = image.toFormat(FormatRf32);
+			Image stack_image;
+			if(!input_image || !stack_image.create2D(FormatRf32, width, height * layers)) {
+				TS_LOG(Error, "BlueNoise::dispatch_volume(): can't create stacked image\n");
+				return Array<Image>();
+			}
+			bool layered = (input_image.getLayers() == layers);
+			uint8_t *stack_data = stack_image.getData();
+			size_t stack_stride = stack_image.getStride();
+			for(uint32_t l = 0; l < layers; l++) {
+				ImageSampler input_sampler = (layered) ? ImageSampler(input_image, Layer(l)) : ImageSampler(input_image);
+				const uint8_t *input_data = input_sampler.getData();
+				size_t input_stride = input_sampler.getStride();
+				uint32_t offset_x = (layered) ? 0 : (uint32_t)(width * 0.618034f * l) % width;
+				uint32_t offset_y = (layered) ? 0 : (uint32_t)(height * 0.381966f * l) % height;
+				for(uint32_t y = 0; y < height; y++) {
+					const float32_t *src = (const float32_t*)(input_data + input_stride * ((y + offset_y) % height));
+					float32_t *dest = (float32_t*)(stack_data + stack_stride * (height * l + y));
+					Memory::copy(dest, src + offset_x, sizeof(float32_t) * (width - offset_x));
+					Memory::copy(dest + width - offset_x, src, sizeof(float32_t) * offset_x);
+				}
+			}
+			stack_images.append(stack_image);
+		}
+		
+		// dispatch stacked images
+		// the layer sink receives the layers after the stacked image is split
+		LayerCallback callback = layer_callback;
+		layer_callback = LayerCallback();
+		volume_layers = layers;
+		Array<Image> noise_images = dispatch(device, stack_images, 1, sigma, epsilon);
+		volume_layers = 1;
+		layer_callback = callback;
+		if(!noise_images) return Array<Image>();
+		
+		// split stacked images
+		for(uint32_t i = 0; i < noise_images.size(); i++) {
+			const Image &stack_image = noise_images[i];
+			Image noise_image;
+			if(!noise_image.create2D(stack_image.getFormat(), width, height, (layer_callback) ? 1 : layers)) {
+				TS_LOG(Error, "BlueNoise::dispatch_volume(): can't create noise image\n");
+				return Array<Image>();
+			}
+			const uint8_t *stack_data = stack_image.getData();
+			size_t stack_stride = stack_image.getStride();
+			size_t row_size = (size_t)stack_image.getPixelSize() * width;
+			for(uint32_t l = 0; l < layers; l++) {
+				ImageSampler noise_sampler(noise_image, Layer((layer_callback) ? 0 : l));
+				uint8_t *noise_data = noise_sampler.getData();
+				size_t noise_stride = noise_sampler.getStride();
+				for(uint32_t y = 0; y < height; y++) {
+					Memory::copy(noise_data + noise_stride * y, stack_data + stack_stride * (height * l + y), row_size);
+				}
+				if(layer_callback && !send_layer(i, l, noise_image)) return Array<Image>();
+			}
+			noise_images[i] = noise_image;
+		}
+		
+		return noise_images;
+	}
+	
+	/*
+	 */
+	Array<Image> BlueNoise::dispatch_tiles(const Device &device, const Array<Image> &images, uint32_t layers, float32_t sigma, float32_t epsilon) {
+		
+		// tile window
+		// the window core is surrounded by the halo of the energy kernel radius
+		uint32_t width = images[0].getWidth();
+		uint32_t height = images[0].getHeight();
+		uint32_t window = get_transform_size(tile_size);
+		uint32_t halo = (uint32_t)ceil(sigma * energy_radius);
+		if(window <= halo * 4) {
+			TS_LOGF(Error, "BlueNoise::dispatch_tiles(): tile size %u is too small for halo %u\n", window, halo);
+			return Array<Image>();
+		}
+		uint32_t core = window - halo * 2;
+		
+		// the image fits into a single window
+		if(width <= window && height <= window) {
+			uint32_t size = tile_size;
+			tile_size = 0;
+			Array<Image> noise_images = dispatch(device, images, layers, sigma, epsilon);
+			tile_size = size;
+			return noise_images;
+		}
+		
+		// the windows are placed inside the image, so both sides must cover the window
+		if(width < window || height < window) {
+			TS_LOGF(Error, "BlueNoise::dispatch_tiles(): image side %ux%u is smaller than the tile window %u\n", width, height, window);
+			return Array<Image>();
+		}
+		
+		// create rank images
+		// the layer sink keeps only the current layer
+		uint32_t num_pixels = width * height;
+		uint32_t noise_layers = (layer_callback) ? 1 : layers;
+		Array<Image> input_images;
+		Array<Image> rank_images;
+		Array<Image> layer_images;
+		Array<uint32_t> num_positions;
+		for(const Image &image : images) {
+			Image input_image = image.toFormat(FormatRf32);
+			Image rank_image;
+			Image layer_image;
+			if(noise_layers > 1) layer_image.create2D(FormatRf32, width, height, noise_layers);
+			else layer_image.create2D(FormatRf32, width, height);
+			if(!input_image || !rank_image.create2D(FormatRf32, width, height) || !layer_image) {
+				TS_LOG(Error, "BlueNoise::dispatch_tiles(): can't create rank image\n");
+				return Array<Image>();
+			}
+			
+			// initial positions
+			// the next layers are seeded with the same number of positions
+			uint32_t positions = 0;
+			const uint8_t *input_data = input_image.getData();
+			size_t input_stride = input_image.getStride();
+			for(uint32_t y = 0; y < height; y++) {
+				const float32_t *row = (const float32_t*)(input_data + input_stride * y);
+				for(uint32_t x = 0; x < width; x++) {
+					positions += (row[x] > 0.5f) ? 1 : 0;
+				}
+			}
+			
+			input_images.append(input_image);
+			rank_images.append(rank_image);
+			layer_images.append(layer_image);
+			num_positions.append(positions);
+		}
+		
+		// window state
+		// every window is a complete dispatch, so the state of the whole image is disabled
+		LayerCallback callback = layer_callback;
+		String name = checkpoint_name;
+		Flags old_flags = flags;
+		uint32_t old_count = select_count;
+		uint32_t bits = output_bits;
+		if(resume) {
+			TS_LOG(Warning, "BlueNoise::dispatch_tiles(): checkpoint is not supported by tiled noise\n");
+			resume_checkpoint = Checkpoint();
+			resume = false;
+		}
+		if(flags & FlagIncremental) TS_LOG(Warning, "BlueNoise::dispatch_tiles(): incremental energy is not supported by tiled noise\n");
+		if(select_count > 1) TS_LOG(Warning, "BlueNoise::dispatch_tiles(): multiple selection is not supported by tiled noise\n");
+		layer_callback = LayerCallback();
+		checkpoint_name = String();
+		flags = (Flags)(flags & ~FlagIncremental);
+		select_count = 1;
+		output_bits = 32;
+		
+		// dispatch tile window
+		// the window wraps around the image, so the border tiles continue on the opposite side
+		Array<uint32_t> columns(window);
+		Array<uint32_t> rows(window);
+		auto dispatch_tile = [&](uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1) -> bool {
+			
+			// window coordinates
+			for(uint32_t i = 0; i < window; i++) {
+				columns[i] = (x0 + i + width - halo % width) % width;
+				rows[i] = (y0 + i + height - halo % height) % height;
+			}
+			tile_core = Vector4u(halo, halo, x1 - x0, y1 - y0);
+			
+			// gather window images
+			// the halo is empty in the input window, and its ranks are passed to the halo kernel
+			Array<Image> window_images;
+			tile_images.clear();
+			for(uint32_t i = 0; i < images.size(); i++) {
+				Image window_image;
+				Image tile_image;
+				if(!window_image.create2D(FormatRf32, window, window) || !tile_image.create2D(FormatRf32, window, window)) {
+					TS_LOG(Error, "BlueNoise::dispatch_tiles(): can't create window image\n");
+					return false;
+				}
+				const uint8_t *input_data = input_images[i].getData();
+				const uint8_t *rank_data = rank_images[i].getData();
+				uint8_t *window_data = window_image.getData();
+				uint8_t *tile_data = tile_image.getData();
+				size_t input_stride = input_images[i].getStride();
+				size_t rank_stride = rank_images[i].getStride();
+				size_t window_stride = window_image.getStride();
+				for(uint32_t y = 0; y < window; y++) {
+					const float32_t *input_row = (const float32_t*)(input_data + input_stride * rows[y]);
+					const float32_t *rank_row = (const float32_t*)(rank_data + rank_stride * rows[y]);
+					float32_t *window_row = (float32_t*)(window_data + window_stride * y);
+					float32_t *tile_row = (float32_t*)(tile_data + window_stride * y);
+					bool inside = (y >= halo && y < halo + tile_core.w);
+					for(uint32_t x = 0; x < window; x++) {
+						window_row[x] = (inside && x >= halo && x < halo + tile_core.z) ? input_row[columns[x]] : 0.0f;
+						tile_row[x] = rank_row[columns[x]];
+					}
+				}
+				window_images.append(window_image);
+				tile_images.append(tile_image);
+			}
+			
+			// dispatch window images
+			Array<Image> noise_images = dispatch(device, window_images, 1, sigma, epsilon);
+			if(!noise_images) return false;
+			
+			// scatter core ranks
+			for(uint32_t i = 0; i < noise_images.size(); i++) {
+				const uint8_t *noise_data = noise_images[i].getData();
+				uint8_t *rank_data = rank_images[i].getData();
+				size_t noise_stride = noise_images[i].getStride();
+				size_t rank_stride = rank_images[i].getStride();
+				for(uint32_t y = 0; y < tile_core.w; y++) {
+					const float32_t *src = (const float32_t*)(noise_data + noise_stride * (halo + y));
+					float32_t *dest = (float32_t*)(rank_data + rank_stride * (y0 + y));
+					Memory::copy(dest + x0, src + halo, sizeof(float32_t) * tile_core.z);
+				}
+			}
+			
+			return true;
+		};
+		
+		// dispatch layers
+		// the tile cores are distributed evenly, and the tiles are generated in raster order
+		Format output_format = (bits == 8) ? FormatRu8n : (bits == 16) ? FormatRu16n : FormatRf32;
+		uint32_t tiles_x = udiv(width, core);
+		uint32_t tiles_y = udiv(height, core);
+		bool result = true;
+		for(uint32_t l = 0; l < layers && result; l++) {
+			
+			// the ranks of the unfinished tiles are negative
+			for(Image &rank_image : rank_images) {
+				uint8_t *rank_data = rank_image.getData();
+				size_t rank_stride = rank_image.getStride();
+				for(uint32_t y = 0; y < height; y++) {
+					float32_t *row = (float32_t*)(rank_data + rank_stride * y);
+					for(uint32_t x = 0; x < width; x++) {
+						row[x] = -1.0f;
+					}
+				}
+			}
+			
+			// dispatch tiles
+			for(uint32_t y = 0; y < tiles_y && result; y++) {
+				for(uint32_t x = 0; x < tiles_x && result; x++) {
+					result = dispatch_tile(width * x / tiles_x, height * y / tiles_y, width * (x + 1) / tiles_x, height * (y + 1) / tiles_y);
+				}
+			}
+			
+			for(uint32_t i = 0; i < rank_images.size() && result; i++) {
+				const uint8_t *rank_data = rank_images[i].getData();
+				size_t rank_stride = rank_images[i].getStride();
+				
+				// copy layer ranks
+				ImageSampler layer_sampler(layer_images[i], Layer((callback) ? 0 : l));
+				uint8_t *layer_data = layer_sampler.getData();
+				size_t layer_stride = layer_sampler.getStride();
+				for(uint32_t y = 0; y < height; y++) {
+					Memory::copy(layer_data + layer_stride * y, rank_data + rank_stride * y, sizeof(float32_t) * width);
+				}
+				
+				// layer sink
+				// the sink is restored only for the finished layer, so the windows don't stream their layers
+				if(callback) {
+					Image noise_image = rank_images[i].toFormat(output_format);
+					layer_callback = callback;
+					result = (noise_image && send_layer(i, l, noise_image));
+					layer_callback = LayerCallback();
+				}
+				
+				// next layer
+				// the mirrored inverse ranks seed the next layer like the layer kernel
+				if(l + 1 < layers) {
+					float32_t threshold = (float32_t)num_positions[i] / (float32_t)num_pixels;
+					uint8_t *input_data = input_images[i].getData();
+					size_t input_stride = input_images[i].getStride();
+					for(uint32_t y = 0; y < height; y++) {
+						const float32_t *rank_row = (const float32_t*)(rank_data + rank_stride * (height - y - 1));
+						float32_t *input_row = (float32_t*)(input_data + input_stride * y);
+						for(uint32_t x = 0; x < width; x++) {
+							input_row[x] = (1.0f - rank_row[width - x - 1] < threshold) ? 1.0f : 0.0f;
+						}
+					}
+				}
+			}
+		}
+		
+		// restore state
+		tile_core = Vector4u(0, 0, 0, 0);
+		tile_images.clear();
+		layer_callback = callback;
+		checkpoint_name = name;
+		flags = old_flags;
+		select_count = old_count;
+		output_bits = bits;
+		if(!result) return Array<Image>();
+		
+		// noise images
+		Array<Image> noise_images;
+		for(const Image &layer_image : layer_images) {
+			Image noise_image = layer_image.toFormat(output_format);
+			if(!noise_image) {
+				TS_LOG(Error, "BlueNoise::dispatch_tiles(): can't create noise image\n");
+				return Array<Image>();
+			}
+			noise_images.append(noise_image);
+		}
 		
-		return noise_image;
+		return noise_images;
 	}
 	
 	/*
 	 */
-	Image BlueNoise::dispatchForward(const Device &device, const Image &image) {
+	Image BlueNoise::dispatchForward(const Device &device, const Image &image, Magnitude magnitude) {
 		
 		// check image size
 		uint32_t width = image.getWidth();
@@ -456,59 +2271,202 @@ namespace Tellusim {
 			return Image();
 		}
 		
-		// create forward texture
-		Texture forward_texture = device.createTexture2D(FormatRGf32, width / 2 + 1, height, Texture::FlagSource | Texture::FlagSurface);
+		// create textures
+		Texture forward_texture = device.createTexture2D(FormatRGf32, width / 2 + 1, height, Texture::FlagSurface);
+		Texture magnitude_texture = device.createTexture2D(FormatRf32, width, height, Texture::FlagSource | Texture::FlagSurface);
+		if(!forward_texture || !magnitude_texture) {
+			TS_LOG(Error, "BlueNoise::dispatchForward(): can't create forward texture\n");
+			return Image();
+		}
+		
+		// dispatch forward transform
+		FourierTransform forward_transform;
+		if(!get_forward_transform(device, width, height, forward_transform)) return Image();
 		{
 			Compute compute = device.createCompute();
-			if(!forward_texture || !transform.dispatch(compute, FourierTransform::ModeRf32i, FourierTransform::ForwardRtoC, forward_texture, noise_texture)) {
-				TS_LOG(Error, "BlueNoise::dispatchForward(): can't create forward texture\n");
+			if(!forward_transform.dispatch(compute, FourierTransform::ModeRf32i, FourierTransform::ForwardRtoC, forward_texture, noise_texture)) {
+				TS_LOG(Error, "BlueNoise::dispatchForward(): can't dispatch forward transform\n");
 				return Image();
 			}
+			
+			// centered magnitude
+			compute.setKernel(magnitude_kernel);
+			compute.setUniform(0, (int32_t)magnitude);
+			compute.setTexture(0, forward_texture);
+			compute.setSurfaceTexture(0, magnitude_texture);
+			compute.dispatch(magnitude_texture);
+			compute.barrier(magnitude_texture);
 		}
 		
 		device.finish();
 		
-		// get complex image
-		Image complex_image;
-		complex_image.create2D(FormatRGf32, width / 2 + 1, height);
-		device.getTexture(forward_texture, complex_image);
-		ImageSampler complex_sampler(complex_image);
-		
-		// create forward image
+		// get forward image
 		Image forward_image;
 		forward_image.create2D(FormatRf32, width, height);
-		ImageSampler forward_sampler(forward_image);
-		
-		// convert forward image
-		uint32_t width_2 = width / 2;
-		uint32_t height_2 = height / 2;
-		for(uint32_t y = 0; y < height_2; y++) {
-			for(uint32_t x = 0; x < width_2 + 1; x++) {
-				if(x == width_2 && y == height_2 - 1) continue;
-				ImageColor pixel = complex_sampler.get2D(width_2 - x, height_2 - y - 1);
-				pixel.f.r = sqrt(pixel.f.r * pixel.f.r + pixel.f.g * pixel.f.g);
-				forward_sampler.set2D(x, y, pixel);
-				if(x) forward_sampler.set2D(width - x, y, pixel);
-			}
-			for(uint32_t x = 0; x < width_2 + 1; x++) {
-				if(x == width_2 && y == height_2 - 1) continue;
-				ImageColor pixel = complex_sampler.get2D(width_2 - x, height - y - 1);
-				pixel.f.r = sqrt(pixel.f.r * pixel.f.r + pixel.f.g * pixel.f.g);
-				forward_sampler.set2D(x, height_2 + y, pixel);
-				if(x) forward_sampler.set2D(width - x, height_2 + y, pixel);
+		if(!device.getTexture(magnitude_texture, forward_image)) {
+			TS_LOG(Error, "BlueNoise::dispatchForward(): can't get forward texture\n");
+			return Image();
+		}
+		
+		return forward_image;
+	}
+	
+	/*
+	 */
+	Image BlueNoise::dispatchForward(const Device &device, const Image &image, Spectrum spectrum, Magnitude magnitude) {
+		
+		// single layer image
+		uint32_t layers = image.getLayers();
+		if(!layers && spectrum == SpectrumLayers) return dispatchForward(device, image, magnitude);
+		
+		// check slice size
+		uint32_t width = image.getWidth();
+		uint32_t height = image.getHeight();
+		uint32_t slice_width = (spectrum == SpectrumY) ? layers : width;
+		uint32_t slice_height = (spectrum == SpectrumX) ? layers : height;
+		uint32_t num_slices = (spectrum == SpectrumLayers) ? layers : (spectrum == SpectrumX) ? height : width;
+		if(!ispot(slice_width) || !ispot(slice_height)) {
+			TS_LOGF(Error, "BlueNoise::dispatchForward(): invalid slice size %ux%u\n", slice_width, slice_height);
+			return Image();
+		}
+		
+		// slice transform
+		FourierTransform forward_transform;
+		if(!get_forward_transform(device, slice_width, slice_height, forward_transform)) return Image();
+		
+		// create textures
+		// the magnitude texture holds a batch of slices within the memory limit
+		uint32_t magnitude_size = sizeof(float32_t) * slice_width * slice_height;
+		uint32_t batch_slices = clamp((uint32_t)MaxSpectrumSize / magnitude_size, 1u, num_slices);
+		Texture noise_texture = device.createTexture(image);
+		Texture slice_texture = device.createTexture2D(FormatRf32, slice_width, slice_height, Texture::FlagSurface);
+		Texture forward_texture = device.createTexture2D(FormatRGf32, slice_width / 2 + 1, slice_height, Texture::FlagSurface);
+		Texture magnitude_texture = device.createTexture2D(FormatRf32, slice_width, slice_height, batch_slices, Texture::FlagSource | Texture::FlagSurface);
+		if(!noise_texture || !slice_texture || !forward_texture || !magnitude_texture) {
+			TS_LOG(Error, "BlueNoise::dispatchForward(): can't create textures\n");
+			return Image();
+		}
+		
+		// create images
+		Image forward_image;
+		Image batch_image;
+		forward_image.create2D(FormatRf32, slice_width, slice_height, num_slices);
+		batch_image.create2D(FormatRf32, slice_width, slice_height, batch_slices);
+		
+		// slice parameters
+		struct SliceParameters {
+			int32_t mode;
+			int32_t slice;
+		};
+		
+		for(uint32_t base = 0; base < num_slices; base += batch_slices) {
+			uint32_t count = min(batch_slices, num_slices - base);
+			
+			// dispatch slice transforms
+			{
+				Compute compute = device.createCompute();
+				for(uint32_t i = 0; i < count; i++) {
+					
+					// extract slice
+					SliceParameters slice_parameters = {};
+					slice_parameters.mode = (int32_t)spectrum;
+					slice_parameters.slice = (int32_t)(base + i);
+					compute.setKernel(slice_kernel);
+					compute.setUniform(0, slice_parameters);
+					compute.setTexture(0, noise_texture);
+					compute.setSurfaceTexture(0, slice_texture);
+					compute.dispatch(slice_texture);
+					compute.barrier(slice_texture);
+					
+					// forward transform
+					if(!forward_transform.dispatch(compute, FourierTransform::ModeRf32i, FourierTransform::ForwardRtoC, forward_texture, slice_texture)) {
+						TS_LOG(Error, "BlueNoise::dispatchForward(): can't dispatch forward transform\n");
+						return Image();
+					}
+					
+					// centered magnitude
+					compute.setKernel(magnitude_kernel);
+					compute.setUniform(0, (int32_t)magnitude);
+					compute.setTexture(0, forward_texture);
+					compute.setSurfaceTexture(0, magnitude_texture, Slice(Layer(i)));
+					compute.dispatch(slice_width, slice_height);
+					compute.barrier(magnitude_texture);
+				}
+			}
+			
+			device.finish();
+			
+			// get forward images
+			if(!device.getTexture(magnitude_texture, batch_image)) {
+				TS_LOG(Error, "BlueNoise::dispatchForward(): can't get magnitude texture\n");
+				return Image();
+			}
+			for(uint32_t i = 0; i < count; i++) {
+				forward_image.copy(batch_image.getSlice(Layer(i)), Layer(base + i));
 			}
 		}
+		
 		return forward_image;
 	}
 	
 	/*
 	 */
-	void BlueNoise::print_progress(uint32_t progress, uint64_t begin) {
+	size_t BlueNoise::get_memory() const {
+		
+		// texture sizes
+		// the pixel sizes follow the storage formats
+		auto get_size = [](const Texture &texture, size_t pixel_size) -> size_t {
+			return (texture) ? (size_t)texture.getWidth() * texture.getHeight() * pixel_size : 0;
+		};
+		bool half = (flags & FlagHalf);
+		size_t noise_size = (half) ? 1 : 4;
+		size_t real_size = (half) ? 2 : 4;
+		size_t complex_size = (half) ? 4 : 8;
+		
+		size_t memory = get_size(convolution_texture, real_size) + get_size(impulse_texture, real_size);
+		for(const Job &job : jobs) {
+			memory += get_size(job.noise_texture, noise_size) + get_size(job.copy_texture, noise_size);
+			memory += get_size(job.layer_texture, 4);
+			memory += get_size(job.forward_texture, complex_size) + get_size(job.backward_texture, real_size) + get_size(job.upscale_texture, real_size) + get_size(job.transform_texture, complex_size) + get_size(job.tile_texture, 4);
+			for(const Buffer *buffer : { &job.sequence_buffer, &job.position_buffer, &job.select_buffer, &job.candidate_buffer, &job.counter_buffer, &job.iteration_buffer, &job.converged_buffers[0], &job.converged_buffers[1], &job.readback_buffers[0], &job.readback_buffers[1] }) {
+				if(*buffer) memory += buffer->getSize();
+			}
+		}
+		
+		return memory;
+	}
+	
+	/*
+	 */
+	void BlueNoise::update_progress(uint64_t current, bool done) {
+		
+		// progress interval
 		uint64_t time = Time::current();
-		if(time - old_time > Time::Seconds / 10) {
-			uint64_t remain = (time - begin) * (10000 - min(progress, 10000u)) / max(progress, 1u);
-			Log::printf("\rProgress: %4.1f %% Time: %s Remain: %s                \r", progress / 100.0f, String::fromTime(time - begin).get(), String::fromTime(remain).get());
-			old_time = time;
+		uint64_t interval = (progress_callback) ? (uint64_t)(progress_interval * Time::Seconds) : Time::Seconds / 10;
+		if(!done && time - old_time <= interval) return;
+		old_time = time;
+		
+		// progress callback
+		current = min(current, (uint64_t)progress_pixels);
+		if(progress_callback) {
+			Progress progress;
+			progress.phase = progress_phase;
+			progress.layer = progress_layer;
+			progress.layers = num_layers;
+			progress.iterations = current;
+			progress.total = progress_pixels;
+			progress.time = (float64_t)(time - progress_time) / Time::Seconds;
+			progress.rate = (progress.time > 0.0) ? current / progress.time : 0.0;
+			progress.remain = (current) ? progress.time * (progress_pixels - current) / current : 0.0;
+			progress.memory = get_memory();
+			progress_callback(progress);
+			return;
 		}
+		
+		// progress log
+		uint32_t progress = (uint32_t)(current * 10000ull / max(progress_pixels, 1u));
+		uint64_t remain = (time - progress_time) * (10000 - progress) / max(progress, 1u);
+		Log::printf("\rProgress: %4.1f %% Time: %s Remain: %s                \r", progress / 100.0f, String::fromTime(time - progress_time).get(), String::fromTime(remain).get());
+		if(done) Log::print("\n");
 	}
 }
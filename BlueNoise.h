@@ -23,6 +23,7 @@
 #ifndef __NOISE_BLUE_NOISE_H__
 #define __NOISE_BLUE_NOISE_H__
 
+#include <core/TellusimFunction.h>
 #include <format/TellusimImage.h>
 #include <platform/TellusimPlatforms.h>
 #include <parallel/TellusimFourierTransform.h>
@@ -37,58 +38,479 @@ namespace Tellusim {
 			
 		public:
 			
+			/// generator flags
+			enum Flags {
+				FlagNone = 0,
+				FlagIncremental = (1 << 0),		// incremental energy update
+				FlagHalf = (1 << 1),			// half precision storage
+				FlagVolume = (1 << 2),			// volume noise with the 3D energy kernel
+				DefaultFlags = FlagNone,
+			};
+			
+			/// generation phases
+			enum Phase {
+				PhaseInitial = 0,				// initial sequence
+				PhaseFirst,						// first phase
+				PhaseSecond,					// second phase
+				PhaseThird,						// third phase
+				PhaseRender,					// render and layer kernels
+				NumPhases,
+			};
+			
+			/// phase statistics
+			struct Statistics {
+				uint64_t iterations = 0;		// generated positions
+				uint64_t kernels = 0;			// generation kernel dispatches
+				uint64_t time = 0;				// phase time
+			};
+			
+			/// profile stages
+			enum ProfileStage {
+				ProfileUpscale = 0,				// upscale or tile halo kernels
+				ProfileForward,					// forward energy transform
+				ProfileFilter,					// energy filter kernel
+				ProfileBackward,				// backward energy transform
+				ProfileSample,					// sample kernel
+				ProfileReduce,					// position reduction or selection kernel
+				ProfileUpdate,					// update noise kernel
+				ProfileEnergy,					// incremental energy kernels
+				ProfileRender,					// render noise kernel
+				ProfileInitial,					// initial sequence batches
+				ProfileFirst,					// first phase batches
+				ProfileSecond,					// second phase batches
+				ProfileThird,					// third phase batches
+				NumProfileStages,
+			};
+			
+			/// stage profile
+			struct Profile {
+				uint64_t count = 0;				// stage executions
+				uint64_t samples = 0;			// measured executions
+				float64_t time = 0.0;			// measured time in milliseconds
+				
+				/// estimated time of all executions in milliseconds
+				float64_t getTotalTime() const { return (samples) ? time * count / samples : 0.0; }
+			};
+			
+			/// progress state
+			struct Progress {
+				Phase phase = PhaseInitial;		// generation phase
+				uint32_t layer = 0;				// generation layer
+				uint32_t layers = 0;			// generation layers
+				uint64_t iterations = 0;		// finished iterations
+				uint64_t total = 0;				// total iterations
+				float64_t rate = 0.0;			// iterations per second
+				float64_t time = 0.0;			// elapsed time in seconds
+				float64_t remain = 0.0;			// estimated remaining time in seconds
+				size_t memory = 0;				// allocated device memory in bytes
+			};
+			
+			/// progress callback
+			using ProgressCallback = Function<void(const Progress &progress)>;
+			
+			/// layer callback
+			/// receives the image index, the layer index and the quantized noise layer
+			/// returning false stops the dispatch
+			using LayerCallback = Function<bool(uint32_t index, uint32_t layer, const Image &image)>;
+			
+			/// batch callback
+			/// called after every submitted batch, the callback can pass the device to other generators
+			/// returning false cancels the dispatch
+			using BatchCallback = Function<bool()>;
+			
 			BlueNoise();
 			~BlueNoise();
 			
 			/// create noise generate
-			bool create(const Device &device, uint32_t width, uint32_t height, uint32_t layers);
+			/// time is the target batch submission time in milliseconds, zero keeps the fixed batch size
+			bool create(const Device &device, uint32_t width, uint32_t height, uint32_t layers, Flags flags = DefaultFlags, float32_t time = 0.0f);
+			
+			/// current batch size
+			/// the adaptive batches change the size after every submitted batch
+			uint32_t getBatchSize() const { return batch_size; }
+			
+			/// incremental energy parameters
+			/// radius is the truncated kernel radius in sigma units
+			/// sync is the number of iterations between full energy updates
+			void setEnergyRadius(float32_t radius);
+			void setEnergySync(uint32_t sync);
+			float32_t getEnergyRadius() const { return energy_radius; }
+			uint32_t getEnergySync() const { return energy_sync; }
+			
+			/// multiple selection parameters
+			/// count is the number of positions committed per energy update
+			/// distance is the minimal toroidal distance between positions in sigma units
+			void setSelection(uint32_t count, float32_t distance);
+			uint32_t getSelectionCount() const { return select_count; }
+			float32_t getSelectionDistance() const { return select_distance; }
+			
+			/// checkpoint parameters
+			/// the generation state is saved into the file every interval seconds and removed after the dispatch
+			void setCheckpoint(const char *name, float32_t interval);
+			const String &getCheckpointName() const { return checkpoint_name; }
+			
+			/// resume the next dispatch from the checkpoint file
+			bool loadCheckpoint(const char *name);
+			
+			/// output bits
+			/// the ranks are quantized to 8 or 16 bits on the device, 32 bits keeps the float ranks
+			void setOutputBits(uint32_t bits);
+			uint32_t getOutputBits() const { return output_bits; }
+			
+			/// layer sink
+			/// every noise layer is passed to the callback in the output format as soon as it's read back
+			/// the dispatch keeps only one layer per image, so the returned images contain the last layer
+			void setLayerCallback(const LayerCallback &callback);
+			
+			/// batch callback
+			void setBatchCallback(const BatchCallback &callback);
+			
+			/// tile size
+			/// the image larger than the tile window is generated tile by tile, zero disables the tiled generation
+			/// the window core is refined against the finished ranks in the halo of the energy kernel radius
+			/// every layer is tiled separately and seeded by the mirrored inverse ranks of the previous whole layer
+			/// the size must be set before create(), which sizes the transform by the tile window
+			void setTileSize(uint32_t size);
+			uint32_t getTileSize() const { return tile_size; }
 			
 			/// dispatch noise generator
 			Image dispatch(const Device &device, const Image &image, uint32_t layers, float32_t sigma, float32_t epsilon);
 			
+			/// dispatch noise generator for multiple images
+			/// all images must have the same size, their iterations share the command batches
+			/// every image still dispatches its own kernels and transforms
+			/// textures, buffers and the kernel spectrum are reused by the next dispatch of the same size
+			Array<Image> dispatch(const Device &device, const Array<Image> &images, uint32_t layers, float32_t sigma, float32_t epsilon);
+			
+			/// merge up to four noise images into the RGBA image with the same component format
+			/// the channels are generated by separate runs and only interleaved on the host, the missing channels are zero
+			static Image mergeChannels(const Array<Image> &images);
+			
+			/// phase statistics
+			/// the device is finished at the phase boundaries, so the phase times don't overlap
+			/// statistics are reset by every dispatch
+			void setStatistics(bool enabled);
+			bool isStatistics() const { return statistics_enabled; }
+			const Statistics &getStatistics(Phase phase) const { return statistics[phase]; }
+			static const char *getPhaseName(Phase phase);
+			
+			/// progress callback
+			/// the callback replaces the progress log, it's called every interval seconds and after the dispatch
+			void setProgressCallback(const ProgressCallback &callback, float32_t interval = 1.0f);
+			
+			/// GPU profile
+			/// the stages of every ProfileInterval-th generation kernel and all phase batches are measured with timer queries
+			/// the profile is reset by every dispatch
+			void setProfile(bool enabled);
+			bool isProfile() const { return profile_enabled; }
+			const Profile &getProfile(ProfileStage stage) const { return profiles[stage]; }
+			static const char *getProfileName(ProfileStage stage);
+			
+			/// forward transform slices
+			enum Spectrum {
+				SpectrumLayers = 0,				// spectrum of every layer
+				SpectrumX,						// spectrum of every XZ slice along the Y axis
+				SpectrumY,						// spectrum of every ZY slice along the X axis
+			};
+			
+			/// forward transform magnitude
+			enum Magnitude {
+				MagnitudeLinear = 0,			// linear magnitude
+				MagnitudeLog,					// logarithmic magnitude
+			};
+			
 			/// dispatch forward transform
-			Image dispatchForward(const Device &device, const Image &image);
+			/// the centered magnitude image is computed on the device
+			Image dispatchForward(const Device &device, const Image &image, Magnitude magnitude = MagnitudeLinear);
+			
+			/// dispatch forward transform of all slices of the layered image
+			/// the slices are extracted and transformed on the device in batches with a single readback per batch
+			/// the result contains the spectrum of every slice in a separate layer
+			Image dispatchForward(const Device &device, const Image &image, Spectrum spectrum, Magnitude magnitude = MagnitudeLinear);
 			
 		private:
 			
+			/// sample types
+			enum Sample {
+				SampleMin = 0,
+				SampleMax,
+			};
+			
+			/// generation job
+			struct Job {
+				Texture noise_texture;		// binary noise texture
+				Texture copy_texture;		// copy noise texture
+				Texture layer_texture;		// layer ranks texture
+				Texture forward_texture;	// forward texture
+				Texture backward_texture;	// backward texture
+				Texture upscale_texture;	// upscale texture
+				Texture transform_texture;	// mixed-radix transform texture
+				Texture tile_texture;		// tile halo ranks texture
+				Buffer sequence_buffer;		// noise sequence buffer
+				Buffer position_buffer;		// noise position buffer
+				Buffer select_buffer;		// noise selection buffer
+				Buffer candidate_buffer;	// selection candidate buffer
+				Buffer counter_buffer;		// reduction counter buffer
+				Buffer iteration_buffer;	// iteration state buffer
+				Buffer converged_buffers[2];	// delayed iteration state buffers
+				Buffer readback_buffers[2];	// double-buffered readback buffers
+				Image noise_image;			// noise image
+				uint32_t num_positions = 0;	// initial positions
+				uint32_t energy_index = 0;	// energy iteration index
+				uint32_t index = 0;			// phase iteration index
+				uint32_t end = 0;			// phase iteration end
+			};
+			
+			/// create generation job
+			bool create_job(const Device &device, Job &job, const Image &image, uint32_t width, uint32_t height, uint32_t layers);
+			
+			/// dispatch volume noise
+			/// the layers are stacked vertically into a single image, and the mixed-radix transform works along the columns and the layers
+			Array<Image> dispatch_volume(const Device &device, const Array<Image> &images, uint32_t layers, float32_t sigma, float32_t epsilon);
+			
+			/// dispatch tiled noise
+			/// the tiles are generated in windows of the tile size, and the ranks of every tile core are kept on the host
+			Array<Image> dispatch_tiles(const Device &device, const Array<Image> &images, uint32_t layers, float32_t sigma, float32_t epsilon);
+			
+			/// dispatch energy transform
+			bool dispatch_energy(Compute &compute, Job &job, Texture &dest, Texture &src);
+			
+			/// transform size
+			/// power of two sizes use the library transform, other sizes are rounded up to the nearest 2-3-5-7 size
+			static bool is_transform_size(uint32_t size);
+			static uint32_t get_transform_size(uint32_t size);
+			
+			/// forward transform of the image size
+			bool get_forward_transform(const Device &device, uint32_t width, uint32_t height, FourierTransform &forward_transform);
+			
+			/// dispatch mixed-radix transform
+			/// the full complex spectrum is stored in the forward texture
+			/// the filtered backward transform multiplies the spectrum by the convolution spectrum in its first pass
+			bool dispatch_mixed(Compute &compute, Job &job, Texture &dest, Texture &src, bool forward, bool filter = false);
+			
 			/// dispatch generation kernel
-			bool dispatch_kernel(const Device &device, Compute &compute, Texture &texture, Kernel &kernel, float32_t value, uint32_t index);
+			/// the phase selects the halo ranks of the tile window
+			bool dispatch_kernel(const Device &device, Compute &compute, Job &job, Texture &texture, Phase phase, Sample sample, float32_t value, uint32_t count = 1);
+			
+			/// iteration state
+			/// the update kernel advances the index and detects the initial sequence convergence
+			struct IterationState {
+				uint32_t index;				// sequence index
+				int32_t step;				// sequence step
+				uint32_t inserted;			// last inserted position
+				uint32_t converged;			// initial sequence convergence flag
+				uint32_t selected;			// committed selection count
+			};
+			
+			/// set iteration state
+			bool set_iteration(const Device &device, Job &job, uint32_t index, int32_t step);
+			
+			/// device sequence index
+			/// the multiple selection can commit fewer positions than requested, so the device index is behind the job index
+			bool get_iteration(const Device &device, Job &job, uint32_t &index);
+			
+			/// initial sequence convergence
+			/// the swap is converged when the removed cluster pixel is the inserted void pixel
+			/// the iteration state copy of the batch is read back after the next batch is submitted
+			bool is_converged(const Device &device, Job &job, uint32_t batch, bool &converged);
+			
+			/// dispatch generation phase
+			bool dispatch_phase(const Device &device, Phase phase, uint32_t layer, uint32_t num_pixels, uint32_t progress);
+			
+			/// read back the pending noise layer
+			bool flush_readback(const Device &device);
+			
+			/// pass the noise layer to the sink
+			bool send_layer(uint32_t index, uint32_t layer, const Image &image);
+			
+			/// checkpoint job state
+			struct CheckpointJob {
+				uint32_t num_positions = 0;		// initial positions
+				uint32_t index = 0;				// phase iteration index
+				Array<uint8_t> noise_pattern;	// binary noise pattern
+				Array<uint8_t> copy_pattern;	// copy noise pattern
+				Array<uint32_t> sequence;		// packed noise sequence
+				Array<float32_t> layers;		// finished layers
+			};
+			
+			/// checkpoint state
+			struct Checkpoint {
+				uint32_t width = 0;				// image width
+				uint32_t height = 0;			// image height
+				uint32_t layers = 0;			// image layers
+				uint32_t phase = 0;				// generation phase
+				uint32_t layer = 0;				// generation layer
+				uint32_t stored = 0;			// stored finished layers
+				Array<CheckpointJob> jobs;		// job states
+			};
+			
+			class CheckpointWriter;
+			
+			/// save and restore checkpoint state
+			bool save_checkpoint(const Device &device, Phase phase, uint32_t layer);
+			bool restore_checkpoint(const Device &device, uint32_t width, uint32_t height, uint32_t layers);
+			
+			/// compare the phase with the resume position
+			int32_t compare_resume(Phase phase, uint32_t layer) const;
 			
-			/// print progress
-			void print_progress(uint32_t progress, uint64_t begin);
+			/// update batch queries
+			void update_batches();
+			
+			/// profile queries
+			/// the stage is counted always and measured only when a query is free
+			uint32_t begin_profile(Compute &compute, ProfileStage stage, bool sample);
+			void end_profile(Compute &compute, uint32_t index);
+			void update_profile();
+			
+			/// number of selected positions
+			uint32_t get_select_count(uint32_t remain, uint32_t empty) const;
+			
+			/// allocated device memory
+			size_t get_memory() const;
+			
+			/// report progress
+			void update_progress(uint64_t current, bool done = false);
 			
 			enum {
 				MinSize				= 64,
 				BatchSize			= 512,
+				MinBatchSize		= 16,
+				MaxBatchSize		= 16384,
+				NumBatchQueries		= 4,
+				NumProfileQueries	= 256,
+				ProfileInterval		= 64,
 				InverseGroupSize	= 16,
 				FilterGroupSize		= 16,
+				MixedGroupSize		= 16,
+				MaxRadix			= 8,
+				KernelGroupSize		= 16,
+				WeightGroupSize		= 256,
 				SampleGroupSize		= 16,
 				PositionGroupSize	= 256,
-				UpdateGroupSize		= 1,
+				SelectGroupSize		= 256,
+				MaxSelection		= SelectGroupSize,
+				MaxCandidates		= SelectGroupSize * 4,
+				UpdateGroupSize		= MaxSelection,
+				EnergyGroupSize		= 16,
 				RenderGroupSize		= 16,
+				MaxSpectrumSize		= 1 << 26,
+				MaxPackedSize		= 1 << 16,
+				CheckpointMagic		= 0x43425354,	// TSBC
+				CheckpointVersion	= 2,
 			};
 			
 			FourierTransform transform;		// Fourier transform
+			FourierTransform half_transform;	// half precision Fourier transform
+			uint32_t transform_width = 0;	// transform width
+			uint32_t transform_height = 0;	// transform height
+			FourierTransform::Mode transform_mode = FourierTransform::ModeRf32i;
+			
+			Format noise_format = FormatRf32;	// binary noise format
+			Format real_format = FormatRf32;	// energy format
+			Format complex_format = FormatRGf32;	// spectrum format
+			float32_t input_scale = 1.0f;	// transform input scale
 			
 			Kernel inverse_kernel;			// inverse kernel
+			Kernel kernel_kernel;			// convolution kernel
+			Kernel weight_kernel;			// kernel weight reduction kernel
+			Kernel spectrum_kernel;			// spectrum kernel
 			Kernel filter_kernel;			// filter kernel
+			Kernel mixed_kernel;			// mixed-radix transform kernel
+			Kernel mixed_real_kernel;		// mixed-radix real output kernel
+			Kernel mixed_filter_kernel;		// mixed-radix filtered input kernel
 			Kernel min_sample_kernel;		// min sample kernel
 			Kernel max_sample_kernel;		// max sample kernel
+			Kernel min_fused_kernel;		// min sample fused reduction kernel
+			Kernel max_fused_kernel;		// max sample fused reduction kernel
 			Kernel position_kernel;			// position reduction kernel
+			Kernel candidate_kernel;		// selection candidate kernel
+			Kernel select_kernel;			// position selection kernel
 			Kernel update_kernel;			// update noise kernel
 			Kernel render_kernel;			// render noise kernel
 			Kernel layer_kernel;			// layer noise kernel
+			Kernel readback_kernels[3];		// 8, 16 and 32-bit readback kernels
 			Kernel upscale_kernel;			// upscale kernel
+			Kernel halo_kernel;				// tile halo kernel
+			Kernel mask_kernel;				// tile halo energy mask kernel
+			Kernel slice_kernel;			// spectrum slice kernel
+			Kernel magnitude_kernel;		// spectrum magnitude kernel
+			Kernel energy_kernel;			// energy update kernel
 			
 			Texture convolution_texture;	// convolution texture
-			Texture forward_textures[2];	// forward textures
-			Texture backward_texture;		// backward texture
-			Texture upscale_texture;		// upscale texture
+			Texture impulse_texture;		// energy impulse texture
+			
+			uint32_t convolution_width = 0;	// convolution width
+			uint32_t convolution_height = 0;	// convolution height
+			uint32_t convolution_layers = 0;	// convolution volume layers
+			float32_t convolution_sigma = 0.0f;	// convolution sigma
+			float32_t convolution_epsilon = 0.0f;	// convolution epsilon
+			
+			Array<Job> jobs;				// generation jobs
+			uint32_t num_layers = 0;		// generation layers
+			uint32_t volume_layers = 1;		// stacked volume layers
+			uint32_t readback_layer = Maxu32;	// pending readback layer
+			Array<uint32_t> readback_data;	// readback buffer data
+			
+			uint32_t tile_size = 0;			// tile size
+			Vector4u tile_core = Vector4u(0, 0, 0, 0);	// tile core offset and size
+			Array<Image> tile_images;		// tile halo ranks images
+			
+			Flags flags = DefaultFlags;		// generator flags
+			uint32_t output_bits = 32;		// output bits
+			
+			float32_t energy_radius = 4.0f;	// energy kernel radius
+			uint32_t energy_sync = 32;		// energy sync iterations
+			uint32_t energy_size = 0;		// energy footprint size
+			
+			uint32_t select_count = 1;		// selection count
+			float32_t select_distance = 3.0f;	// selection distance
+			uint32_t select_size = 1;		// selection size
+			float32_t select_radius = 0.0f;	// selection radius
+			
+			struct BatchQuery {
+				Query query;				// batch time query
+				uint32_t iterations = 0;	// batch iterations
+				uint32_t progress = 0;		// batch progress
+			};
+			
+			float32_t batch_time = 0.0f;	// target batch time
+			uint32_t batch_size = BatchSize;	// current batch size
+			uint32_t batch_index = 0;		// batch query index
+			uint32_t batch_progress = 0;	// completed batch progress
+			BatchQuery batch_queries[NumBatchQueries];
+			
+			String checkpoint_name;			// checkpoint file name
+			float32_t checkpoint_interval = 0.0f;	// checkpoint interval
+			uint64_t checkpoint_time = 0;	// last checkpoint time
+			CheckpointWriter *checkpoint_writer = nullptr;	// checkpoint writer
+			Checkpoint resume_checkpoint;	// loaded checkpoint
+			bool resume = false;			// resume flag
+			
+			LayerCallback layer_callback;	// layer sink callback
+			BatchCallback batch_callback;	// batch callback
+			
+			bool statistics_enabled = false;	// statistics flag
+			Statistics statistics[NumPhases];	// phase statistics
+			
+			struct ProfileQuery {
+				Query query;				// stage time query
+				uint32_t stage = 0;			// profile stage
+				bool pending = false;		// query result is pending
+			};
 			
-			Buffer sequence_buffer;			// noise sequence buffer
-			Buffer position_buffer;			// noise position buffer
+			bool profile_enabled = false;	// profile flag
+			bool profile_sample = false;	// current kernel is measured
+			uint32_t profile_index = 0;		// profile kernel index
+			Profile profiles[NumProfileStages];	// stage profiles
+			Array<ProfileQuery> profile_queries;	// profile queries
 			
+			uint32_t progress_pixels = 0;	// total progress
+			uint64_t progress_time = 0;		// progress begin time
 			uint64_t old_time = 0;			// old progress time
+			Phase progress_phase = PhaseInitial;	// progress phase
+			uint32_t progress_layer = 0;	// progress layer
+			ProgressCallback progress_callback;	// progress callback
+			float32_t progress_interval = 1.0f;	// progress callback interval
 	};
 }
 
@@ -22,12 +22,50 @@
 
 #version 430 core
 
+#ifndef NOISE_FORMAT
+	#define NOISE_FORMAT	r32f
+#endif
+
+#ifndef REAL_FORMAT
+	#define REAL_FORMAT		r32f
+#endif
+
+#ifndef COMPLEX_FORMAT
+	#define COMPLEX_FORMAT	rg32f
+#endif
+
+#if FUSED_SAMPLE
+	#extension GL_KHR_shader_subgroup_basic : require
+	#extension GL_KHR_shader_subgroup_arithmetic : require
+	#extension GL_KHR_shader_subgroup_ballot : require
+#endif
+
+// packed records
+// the sequence and position coordinates are packed into 16 bits
+// the position weight is stored as the ordered integer key, so the keys compare like the weights
+uint pack_position(ivec2 position) {
+	return uint(position.x) | (uint(position.y) << 16u);
+}
+
+ivec2 unpack_position(uint position) {
+	return ivec2(position & 0xffffu, position >> 16u);
+}
+
+uint pack_weight(float weight) {
+	uint bits = floatBitsToUint(weight);
+	return ((bits & 0x80000000u) != 0u) ? ~bits : (bits | 0x80000000u);
+}
+
+float unpack_weight(uint key) {
+	return uintBitsToFloat(((key & 0x80000000u) != 0u) ? (key & 0x7fffffffu) : ~key);
+}
+
 #if INVERSE_SHADER
 	
 	layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
 	
 	layout(binding = 0, set = 0) uniform texture2D in_texture;
-	layout(binding = 1, set = 0, r32f) uniform writeonly image2D out_surface;
+	layout(binding = 1, set = 0, NOISE_FORMAT) uniform writeonly image2D out_surface;
 	
 	/*
 	 */
@@ -44,38 +82,313 @@
 		}
 	}
 	
+#elif KERNEL_SHADER
+	
+	layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+	
+	layout(std140, binding = 0) uniform KernelParameters {
+		float isigma;
+		float epsilon;
+		int layers;
+	};
+	
+	layout(std430, binding = 1) writeonly buffer WeightBuffer { float weight_buffer[]; };
+	
+	layout(binding = 0, set = 1, REAL_FORMAT) uniform writeonly image2D out_surface;
+	
+	shared float weights[GROUP_SIZE * GROUP_SIZE];
+	
+	/*
+	 */
+	void main() {
+		
+		ivec2 surface_size = imageSize(out_surface);
+		ivec2 global_id = ivec2(gl_GlobalInvocationID.xy);
+		uint local_id = gl_LocalInvocationIndex;
+		
+		// wrap-around Gaussian kernel
+		// the volume layers are stacked vertically, so the layer distance wraps around the layers
+		float weight = 0.0f;
+		if(all(lessThan(global_id, surface_size))) {
+			
+			int height = surface_size.y / layers;
+			int x = global_id.x;
+			int y = global_id.y % height;
+			int z = global_id.y / height;
+			float dx = float((x < surface_size.x / 2) ? x : surface_size.x - x);
+			float dy = float((y < height / 2) ? y : height - y);
+			float dz = float((z < layers / 2) ? z : layers - z);
+			float d = dx * dx + dy * dy + dz * dz;
+			
+			weight = exp(-d * isigma) + epsilon / (1.0f + d);
+			
+			imageStore(out_surface, global_id, vec4(weight, 0.0f, 0.0f, 0.0f));
+		}
+		
+		// group kernel weight
+		weights[local_id] = weight;
+		memoryBarrierShared(); barrier();
+		for(uint offset = GROUP_SIZE * GROUP_SIZE / 2u; offset > 0u; offset >>= 1u) {
+			[[branch]] if(local_id < offset) weights[local_id] += weights[local_id + offset];
+			memoryBarrierShared(); barrier();
+		}
+		
+		// save group kernel weight
+		[[branch]] if(local_id == 0u) {
+			weight_buffer[gl_NumWorkGroups.x * gl_WorkGroupID.y + gl_WorkGroupID.x] = weights[0];
+		}
+	}
+	
+#elif WEIGHT_SHADER
+	
+	layout(local_size_x = GROUP_SIZE) in;
+	
+	layout(std140, binding = 0) uniform WeightParameters {
+		uint num_weights;
+		float scale;
+	};
+	
+	layout(std430, binding = 1) buffer WeightBuffer { float weight_buffer[]; };
+	
+	shared float weights[GROUP_SIZE];
+	
+	/*
+	 */
+	void main() {
+		
+		uint local_id = gl_LocalInvocationIndex;
+		
+		// sum group weights
+		float weight = 0.0f;
+		[[loop]] for(uint i = local_id; i < num_weights; i += GROUP_SIZE) {
+			weight += weight_buffer[i];
+		}
+		weights[local_id] = weight;
+		memoryBarrierShared(); barrier();
+		
+		// sum thread weights
+		for(uint offset = GROUP_SIZE / 2u; offset > 0u; offset >>= 1u) {
+			[[branch]] if(local_id < offset) weights[local_id] += weights[local_id + offset];
+			memoryBarrierShared(); barrier();
+		}
+		
+		// save normalization weight
+		[[branch]] if(local_id == 0u) {
+			weight_buffer[0] = scale / weights[0];
+		}
+	}
+	
+#elif SPECTRUM_SHADER
+	
+	layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+	
+	layout(std430, binding = 0) readonly buffer WeightBuffer { float weight_buffer[]; };
+	
+	layout(binding = 0, set = 1) uniform texture2D in_texture;
+	layout(binding = 1, set = 1, REAL_FORMAT) uniform writeonly image2D out_surface;
+	
+	/*
+	 */
+	void main() {
+		
+		ivec2 surface_size = imageSize(out_surface);
+		ivec2 global_id = ivec2(gl_GlobalInvocationID.xy);
+		
+		if(all(lessThan(global_id, surface_size))) {
+			
+			// normalized kernel spectrum
+			float value = texelFetch(in_texture, global_id, 0).x * weight_buffer[0];
+			
+			// the constant energy offset does not change the sample order
+			#if REMOVE_MEAN
+				if(global_id.x == 0 && global_id.y == 0) value = 0.0f;
+			#endif
+			
+			imageStore(out_surface, global_id, vec4(value, 0.0f, 0.0f, 0.0f));
+		}
+	}
+	
 #elif FILTER_SHADER
 	
 	layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
 	
-	layout(binding = 0, set = 0) uniform texture2D in_texture_0;
-	layout(binding = 1, set = 0) uniform texture2D in_texture_1;
-	layout(binding = 2, set = 0, rg32f) uniform writeonly image2D out_surface;
+	layout(binding = 0, set = 0) uniform texture2D in_texture;
+	layout(binding = 1, set = 0, COMPLEX_FORMAT) uniform image2D out_surface;
 	
 	/*
 	 */
 	void main() {
 		
-		ivec2 texture_size = textureSize(in_texture_0, 0);
+		ivec2 surface_size = imageSize(out_surface);
 		ivec2 global_id = ivec2(gl_GlobalInvocationID.xy);
 		
-		[[branch]] if(global_id.x < texture_size.x) {
+		[[branch]] if(global_id.x < surface_size.x) {
+			
+			// noise spectrum
+			vec2 ri = imageLoad(out_surface, global_id).xy;
 			
-			// noise texture
-			vec2 ri_0 = texelFetch(in_texture_0, global_id, 0).xy;
-			float r0 = ri_0.x;
-			float i0 = ri_0.y;
+			// real convolution spectrum
+			float scale = texelFetch(in_texture, global_id, 0).x;
 			
-			// convolution texture
-			vec2 ri_1 = texelFetch(in_texture_1, global_id, 0).xy;
-			float r1 = ri_1.x;
-			float i1 = ri_1.y;
+			imageStore(out_surface, global_id, vec4(ri * scale, 0.0f, 0.0f));
+		}
+	}
+	
+#elif MIXED_SHADER
+	
+	layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+	
+	layout(std140, binding = 0) uniform MixedParameters {
+		int axis;
+		int radix;
+		int stride;
+		int size;
+		int spacing;
+		float direction;
+		float scale;
+	};
+	
+	layout(binding = 0, set = 1) uniform texture2D in_texture;
+	#if FILTER_INPUT
+		layout(binding = 1, set = 1) uniform texture2D filter_texture;
+		layout(binding = 2, set = 1, COMPLEX_FORMAT) uniform writeonly image2D out_surface;
+	#elif REAL_OUTPUT
+		layout(binding = 1, set = 1, REAL_FORMAT) uniform writeonly image2D out_surface;
+	#else
+		layout(binding = 1, set = 1, COMPLEX_FORMAT) uniform writeonly image2D out_surface;
+	#endif
+	
+	#define PI	3.14159265f
+	
+	/*
+	 */
+	vec2 cmul(vec2 a, vec2 b) {
+		return vec2(a.x * b.x - a.y * b.y, a.x * b.y + a.y * b.x);
+	}
+	
+	/*
+	 */
+	void main() {
+		
+		ivec2 surface_size = imageSize(out_surface);
+		ivec2 global_id = ivec2(gl_GlobalInvocationID.xy);
+		
+		// butterfly index and transformed line
+		// the column lines are split into the blocks of size elements with the spacing between them
+		int step = size / radix;
+		int index = global_id.x;
+		ivec2 base = ivec2(0, global_id.y);
+		ivec2 offset = ivec2(1, 0);
+		bool valid = (index < step && global_id.y < surface_size.y);
+		if(axis != 0) {
+			int line = global_id.y / spacing;
+			index = line % step;
+			base = ivec2(global_id.x, (line / step) * size * spacing + global_id.y % spacing);
+			offset = ivec2(0, spacing);
+			valid = (global_id.x < surface_size.x && global_id.y < surface_size.y / radix);
+		}
+		
+		[[branch]] if(valid) {
 			
-			// complex multiplication
-			float r = r0 * r1 - i0 * i1;
-			float i = i0 * r1 + r0 * i1;
+			// twiddled butterfly inputs
+			// the real input texture is loaded with the zero imaginary part
+			// the first backward pass filters the noise spectrum with the real convolution spectrum
+			vec2 values[MAX_RADIX];
+			int k = index % stride;
+			float angle = direction * 2.0f * PI * float(k) / float(stride * radix);
+			for(int r = 0; r < radix; r++) {
+				int i = step * r + index;
+				vec2 value = texelFetch(in_texture, base + offset * i, 0).xy;
+				#if FILTER_INPUT
+					value *= texelFetch(filter_texture, base + offset * i, 0).x;
+				#endif
+				float a = angle * float(r);
+				values[r] = cmul(value, vec2(cos(a), sin(a)));
+			}
 			
-			imageStore(out_surface, global_id, vec4(r, i, 0.0f, 0.0f));
+			// radix transform
+			// the Stockham output order keeps the sequence sorted after the last pass
+			int output_index = (index - k) * radix + k;
+			for(int q = 0; q < radix; q++) {
+				vec2 value = values[0];
+				for(int r = 1; r < radix; r++) {
+					float a = direction * 2.0f * PI * float((r * q) % radix) / float(radix);
+					value += cmul(values[r], vec2(cos(a), sin(a)));
+				}
+				value *= scale;
+				imageStore(out_surface, base + offset * (stride * q + output_index), vec4(value, 0.0f, 0.0f));
+			}
+		}
+	}
+	
+#elif HALO_SHADER
+	
+	layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+	
+	layout(std140, binding = 0) uniform HaloParameters {
+		uvec4 core;
+		float scale;
+		uint num_pixels;
+		uint num_positions;
+		int invert;
+	};
+	
+	layout(std430, binding = 1) readonly buffer IterationBuffer { uint index; int step; };
+	
+	layout(binding = 0, set = 1) uniform texture2D in_texture;
+	layout(binding = 1, set = 1) uniform texture2D rank_texture;
+	layout(binding = 2, set = 1, REAL_FORMAT) uniform writeonly image2D out_surface;
+	
+	/*
+	 */
+	void main() {
+		
+		ivec2 surface_size = imageSize(out_surface);
+		ivec2 global_id = ivec2(gl_GlobalInvocationID.xy);
+		
+		if(all(lessThan(global_id, surface_size))) {
+			
+			float value = texelFetch(in_texture, global_id, 0).x;
+			
+			// the finished halo pixels are set by their ranks at the current density
+			// the unknown pixels of the unfinished tiles contribute the current density
+			uvec2 position = uvec2(global_id);
+			if(any(lessThan(position, core.xy)) || any(greaterThanEqual(position, core.xy + core.zw))) {
+				uint threshold = (index == ~0u) ? num_positions : (step < 0) ? index + 1u : index;
+				float density = float(threshold) / float(num_pixels);
+				float rank = texelFetch(rank_texture, global_id, 0).x;
+				value = (rank < 0.0f) ? density : (rank < density) ? 1.0f : 0.0f;
+				if(invert != 0) value = 1.0f - value;
+			}
+			
+			imageStore(out_surface, global_id, vec4(value * scale, 0.0f, 0.0f, 0.0f));
+		}
+	}
+	
+#elif MASK_SHADER
+	
+	layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+	
+	layout(std140, binding = 0) uniform MaskParameters {
+		uvec4 core;
+		float value;
+	};
+	
+	layout(binding = 0, set = 1, REAL_FORMAT) uniform writeonly image2D out_surface;
+	
+	/*
+	 */
+	void main() {
+		
+		ivec2 surface_size = imageSize(out_surface);
+		ivec2 global_id = ivec2(gl_GlobalInvocationID.xy);
+		
+		// the halo energy excludes the halo pixels from the sampling
+		if(all(lessThan(global_id, surface_size))) {
+			uvec2 position = uvec2(global_id);
+			if(any(lessThan(position, core.xy)) || any(greaterThanEqual(position, core.xy + core.zw))) {
+				imageStore(out_surface, global_id, vec4(value, 0.0f, 0.0f, 0.0f));
+			}
 		}
 	}
 	
@@ -85,9 +398,15 @@
 	
 	layout(std140, binding = 0) uniform SampleParameters {
 		uint num_groups;
+		float threshold;
 	};
 	
-	layout(std430, binding = 1) buffer PositionBuffer { ivec4 position_buffer[]; };
+	#if FUSED_SAMPLE
+		layout(std430, binding = 1) coherent buffer PositionBuffer { uvec2 position_buffer[]; };
+		layout(std430, binding = 2) coherent buffer CounterBuffer { uint counter; };
+	#else
+		layout(std430, binding = 1) buffer PositionBuffer { uvec2 position_buffer[]; };
+	#endif
 	
 	layout(binding = 0, set = 1) uniform texture2D in_texture_0;
 	layout(binding = 1, set = 1) uniform texture2D in_texture_1;
@@ -95,6 +414,44 @@
 	shared float weights[GROUP_SIZE * GROUP_SIZE];
 	shared ivec2 positions[GROUP_SIZE * GROUP_SIZE];
 	
+	#if FUSED_SAMPLE
+		
+		shared bool is_last;
+		
+		/*
+		 */
+		void reduce_group(float weight, ivec2 position) {
+			
+			// find subgroup position with maximum weight
+			float max_weight = subgroupMax(weight);
+			uint lane = subgroupBallotFindLSB(subgroupBallot(weight == max_weight));
+			if(gl_SubgroupInvocationID == lane) {
+				weights[gl_SubgroupID] = max_weight;
+				positions[gl_SubgroupID] = position;
+			}
+			memoryBarrierShared(); barrier();
+			
+			// find group position with maximum weight
+			[[branch]] if(gl_SubgroupID == 0u) {
+				weight = -1e9f;
+				for(uint i = gl_SubgroupInvocationID; i < gl_NumSubgroups; i += gl_SubgroupSize) {
+					if(weight < weights[i]) {
+						weight = weights[i];
+						position = positions[i];
+					}
+				}
+				max_weight = subgroupMax(weight);
+				lane = subgroupBallotFindLSB(subgroupBallot(weight == max_weight));
+				if(gl_SubgroupInvocationID == lane) {
+					weights[0] = max_weight;
+					positions[0] = position;
+				}
+			}
+			memoryBarrierShared(); barrier();
+		}
+		
+	#endif
+	
 	/*
 	 */
 	void main() {
@@ -109,35 +466,80 @@
 		float value = texelFetch(in_texture_0, global_id, 0).x;
 		float weight = texelFetch(in_texture_1, global_id, 0).x;
 		#if MIN_SAMPLE_SHADER
-			if(value > 0.5f) weight = -1e9f;
+			if(value > threshold) weight = -1e9f;
 			else weight = -weight;
 		#elif MAX_SAMPLE_SHADER
-			if(value < 0.5f) weight = -1e9f;
+			if(value < threshold) weight = -1e9f;
 		#else
 			#error unknown shader
 		#endif
-		weights[local_id] = weight;
-		positions[local_id] = global_id;
-		memoryBarrierShared(); barrier();
 		
-		// find position with maximum weight
-		for(uint offset = 1u; offset < GROUP_SIZE * GROUP_SIZE; offset <<= 1u) {
-			uint index = offset * local_id_2;
-			[[branch]] if(index + offset < GROUP_SIZE * GROUP_SIZE) {
-				float weight = weights[index + offset];
-				if(weights[index] < weight) {
-					weights[index] = weight;
-					positions[index] = positions[index + offset];
+		// the threads past the texture edge are never selected
+		if(any(greaterThanEqual(global_id, textureSize(in_texture_0, 0)))) weight = -1e9f;
+		
+		#if FUSED_SAMPLE
+			
+			// find position with maximum weight
+			reduce_group(weight, global_id);
+			
+			// save maximum weight position
+			uint num_positions = gl_NumWorkGroups.x * gl_NumWorkGroups.y;
+			[[branch]] if(local_id == 0u) {
+				uint index = num_groups * group_id.y + group_id.x;
+				position_buffer[index] = uvec2(pack_position(positions[0]), pack_weight(weights[0]));
+				memoryBarrierBuffer();
+				is_last = (atomicAdd(counter, 1u) == num_positions - 1u);
+			}
+			memoryBarrierShared(); barrier();
+			
+			// the last group reduces all group positions
+			[[branch]] if(is_last) {
+				
+				weight = -1e9f;
+				ivec2 position = ivec2(0);
+				for(uint i = local_id; i < num_positions; i += GROUP_SIZE * GROUP_SIZE) {
+					uvec2 group_position = position_buffer[i];
+					float group_weight = unpack_weight(group_position.y);
+					if(weight < group_weight) {
+						weight = group_weight;
+						position = unpack_position(group_position.x);
+					}
+				}
+				reduce_group(weight, position);
+				
+				// save maximum weight position
+				[[branch]] if(local_id == 0u) {
+					position_buffer[0] = uvec2(pack_position(positions[0]), pack_weight(weights[0]));
+					counter = 0u;
 				}
 			}
+			
+		#else
+			
+			weights[local_id] = weight;
+			positions[local_id] = global_id;
 			memoryBarrierShared(); barrier();
-		}
-		
-		// save maximum weight position
-		[[branch]] if(local_id == 0u) {
-			uint index = num_groups * group_id.y + group_id.x;
-			position_buffer[index] = ivec4(positions[0], floatBitsToInt(weights[0]), 0.0f);
-		}
+			
+			// find position with maximum weight
+			for(uint offset = 1u; offset < GROUP_SIZE * GROUP_SIZE; offset <<= 1u) {
+				uint index = offset * local_id_2;
+				[[branch]] if(index + offset < GROUP_SIZE * GROUP_SIZE) {
+					float weight = weights[index + offset];
+					if(weights[index] < weight) {
+						weights[index] = weight;
+						positions[index] = positions[index + offset];
+					}
+				}
+				memoryBarrierShared(); barrier();
+			}
+			
+			// save maximum weight position
+			[[branch]] if(local_id == 0u) {
+				uint index = num_groups * group_id.y + group_id.x;
+				position_buffer[index] = uvec2(pack_position(positions[0]), pack_weight(weights[0]));
+			}
+			
+		#endif
 	}
 	
 #elif POSITION_SHADER
@@ -148,7 +550,7 @@
 		uint num_positions;
 	};
 	
-	layout(std430, binding = 1) buffer PositionBuffer { ivec4 position_buffer[]; };
+	layout(std430, binding = 1) buffer PositionBuffer { uvec2 position_buffer[]; };
 	
 	shared float weights[GROUP_SIZE];
 	shared ivec2 positions[GROUP_SIZE];
@@ -169,11 +571,11 @@
 		[[loop]] for(uint i = 0; i < steps ; i++) {
 			uint index = GROUP_SIZE * i + local_id;
 			[[branch]] if(index < num_positions) {
-				ivec4 position = position_buffer[index];
-				float weight = intBitsToFloat(position.z);
+				uvec2 position = position_buffer[index];
+				float weight = unpack_weight(position.y);
 				if(weights[local_id] < weight) {
 					weights[local_id] = weight;
-					positions[local_id] = position.xy;
+					positions[local_id] = unpack_position(position.x);
 				}
 			}
 		}
@@ -194,10 +596,154 @@
 		
 		// save maximum weight position
 		[[branch]] if(local_id == 0u) {
-			position_buffer[0] = ivec4(positions[0], floatBitsToInt(weights[0]), 0.0f);
+			position_buffer[0] = uvec2(pack_position(positions[0]), pack_weight(weights[0]));
 		}
 	}
 	
+#elif SELECT_SHADER
+	
+	layout(local_size_x = GROUP_SIZE) in;
+	
+	layout(std140, binding = 0) uniform SelectParameters {
+		ivec2 texture_size;
+		uint num_positions;
+		uint count;
+		float radius;
+		uint group_candidates;
+	};
+	
+	#if SELECT_CANDIDATES
+		layout(std430, binding = 1) readonly buffer PositionBuffer { uvec2 position_buffer[]; };
+		layout(std430, binding = 2) writeonly buffer CandidateBuffer { uvec2 candidate_buffer[]; };
+	#else
+		layout(std430, binding = 1) readonly buffer CandidateBuffer { uvec2 candidate_buffer[]; };
+		layout(std430, binding = 2) writeonly buffer SelectBuffer { uvec2 select_buffer[]; };
+		layout(std430, binding = 3) buffer IterationBuffer { uint index; int step; uint inserted; uint converged; uint selected; };
+	#endif
+	
+	shared uvec2 candidates[MAX_CANDIDATES];
+	
+	/*
+	 */
+	void sort_candidates(uint size) {
+		
+		// bitonic sort in the descending order of the weight keys
+		for(uint block = 2u; block <= size; block <<= 1u) {
+			for(uint stride = block >> 1u; stride > 0u; stride >>= 1u) {
+				for(uint i = gl_LocalInvocationIndex; i < size / 2u; i += GROUP_SIZE) {
+					uint j = (i << 1u) - (i & (stride - 1u));
+					uvec2 candidate_0 = candidates[j];
+					uvec2 candidate_1 = candidates[j + stride];
+					bool descending = ((j & block) == 0u);
+					if(descending == (candidate_0.y < candidate_1.y)) {
+						candidates[j] = candidate_1;
+						candidates[j + stride] = candidate_0;
+					}
+				}
+				memoryBarrierShared(); barrier();
+			}
+		}
+	}
+	
+	#if SELECT_CANDIDATES
+		
+		/*
+		 */
+		void main() {
+			
+			uint local_id = gl_LocalInvocationIndex;
+			uint group_id = gl_WorkGroupID.x;
+			
+			// the best position of the strided group positions of every thread
+			uvec2 candidate = uvec2(0u);
+			[[loop]] for(uint index = GROUP_SIZE * group_id + local_id; index < num_positions; index += GROUP_SIZE * gl_NumWorkGroups.x) {
+				uvec2 position = position_buffer[index];
+				if(candidate.y < position.y) candidate = position;
+			}
+			candidates[local_id] = candidate;
+			memoryBarrierShared(); barrier();
+			
+			// save the best group candidates
+			sort_candidates(GROUP_SIZE);
+			[[branch]] if(local_id < group_candidates) {
+				candidate_buffer[group_candidates * group_id + local_id] = candidates[local_id];
+			}
+		}
+		
+	#else
+		
+		shared ivec2 selected[GROUP_SIZE];
+		shared bool separated[GROUP_SIZE];
+		shared uint num_selected;
+		
+		/*
+		 */
+		bool is_separated(ivec2 position, uint begin, uint end, float distance2) {
+			for(uint i = begin; i < end; i++) {
+				ivec2 delta = abs(position - selected[i]);
+				delta = min(delta, texture_size - delta);
+				if(float(delta.x * delta.x + delta.y * delta.y) <= distance2) return false;
+			}
+			return true;
+		}
+		
+		/*
+		 */
+		void main() {
+			
+			uint local_id = gl_LocalInvocationIndex;
+			
+			// sort candidates
+			for(uint i = local_id; i < MAX_CANDIDATES; i += GROUP_SIZE) {
+				candidates[i] = (i < num_positions) ? candidate_buffer[i] : uvec2(0u);
+			}
+			if(local_id == 0u) num_selected = 0u;
+			memoryBarrierShared(); barrier();
+			sort_candidates(MAX_CANDIDATES);
+			
+			// the selected candidates and the empty slots are below the invalid key
+			uint invalid = pack_weight(-1e9f);
+			
+			// the distance is relaxed when there are no separated candidates left
+			float distance2 = radius * radius;
+			
+			[[loop]] while(true) {
+				
+				// every chunk of candidates is tested against the selected positions in parallel
+				[[loop]] for(uint offset = 0u; offset < MAX_CANDIDATES && num_selected < count; offset += GROUP_SIZE) {
+					uint begin = num_selected;
+					uvec2 candidate = candidates[offset + local_id];
+					separated[local_id] = (candidate.y > invalid && is_separated(unpack_position(candidate.x), 0u, begin, distance2));
+					memoryBarrierShared(); barrier();
+					
+					// the separated candidates of the chunk are resolved in the weight order
+					[[branch]] if(local_id == 0u) {
+						uint end = begin;
+						for(uint i = 0u; i < GROUP_SIZE && end < count; i++) {
+							if(!separated[i]) continue;
+							ivec2 position = unpack_position(candidates[offset + i].x);
+							if(!is_separated(position, begin, end, distance2)) continue;
+							selected[end] = position;
+							select_buffer[end] = candidates[offset + i];
+							candidates[offset + i].y = 0u;
+							end++;
+						}
+						num_selected = end;
+					}
+					memoryBarrierShared(); barrier();
+				}
+				
+				if(num_selected >= count) break;
+				if(distance2 > 0.0f) distance2 = (distance2 > 4.0f) ? distance2 * 0.25f : 0.0f;
+				else break;
+			}
+			
+			// the truncated candidates can run out before the count, so only the selected positions are committed
+			[[branch]] if(local_id == 0u) selected = num_selected;
+		}
+		
+	#endif
+	
 #elif UPDATE_SHADER
 	
 	layout(local_size_x = GROUP_SIZE) in;
@@ -205,13 +751,14 @@
 	layout(std140, binding = 0) uniform UpdateParameters {
 		ivec2 texture_size;
 		float value;
-		uint index;
+		uint count;
 	};
 	
-	layout(std430, binding = 1) buffer SequenceBuffer { ivec4 sequence_buffer[]; };
-	layout(std430, binding = 2) buffer PositionBuffer { ivec4 position_buffer[]; };
+	layout(std430, binding = 1) buffer SequenceBuffer { uint sequence_buffer[]; };
+	layout(std430, binding = 2) buffer PositionBuffer { uvec2 position_buffer[]; };
+	layout(std430, binding = 3) buffer IterationBuffer { uint index; int step; uint inserted; uint converged; uint selected; };
 	
-	layout(binding = 0, set = 1, r32f) uniform image2D out_surface;
+	layout(binding = 0, set = 1, NOISE_FORMAT) uniform writeonly image2D out_surface;
 	
 	/*
 	 */
@@ -220,21 +767,35 @@
 		ivec2 surface_size = imageSize(out_surface);
 		uint local_id = gl_LocalInvocationIndex;
 		
-		[[branch]] if(local_id == 0u) {
+		// current sequence index
+		// the multiple selection count is written by the selection kernel
+		uint sequence_index = index;
+		uint num_selected = (count > 1u) ? min(selected, count) : count;
+		memoryBarrierBuffer(); barrier();
+		
+		[[branch]] if(local_id < num_selected) {
 			
-			ivec4 position = position_buffer[0];
+			ivec2 position = unpack_position(position_buffer[local_id].x);
 			
 			// downscale position
 			ivec2 offset = (texture_size - surface_size) / 2;
 			if(position.x < offset.x) position.x += surface_size.x;
 			if(position.y < offset.y) position.y += surface_size.y;
-			position.xy = (position.xy - offset) % surface_size;
+			position = (position - offset) % surface_size;
 			
 			// update noise
-			imageStore(out_surface, position.xy, vec4(value, 0.0f, 0.0f, 0.0f));
+			imageStore(out_surface, position, vec4(value, 0.0f, 0.0f, 0.0f));
 			
 			// update sequence
-			if(index != ~0u) sequence_buffer[index] = position;
+			// the initial sequence is converged when the removed cluster pixel is the inserted void pixel
+			if(sequence_index != ~0u) sequence_buffer[sequence_index + uint(step * int(local_id))] = pack_position(position);
+			else if(value > 0.5f) inserted = pack_position(position);
+			else if(inserted == pack_position(position)) converged = 1u;
+		}
+		
+		// next sequence index
+		[[branch]] if(local_id == 0u && sequence_index != ~0u) {
+			index = sequence_index + uint(step * int(num_selected));
 		}
 	}
 	
@@ -247,7 +808,7 @@
 		int height;
 	};
 	
-	layout(std430, binding = 1) buffer SequenceBuffer { ivec4 sequence_buffer[]; };
+	layout(std430, binding = 1) readonly buffer SequenceBuffer { uint sequence_buffer[]; };
 	
 	layout(binding = 0, set = 1, r32f) uniform writeonly image2D out_surface;
 	
@@ -261,7 +822,7 @@
 		if(all(lessThan(global_id, surface_size))) {
 			
 			int index = width * global_id.y + global_id.x;
-			ivec2 position = sequence_buffer[index].xy;
+			ivec2 position = unpack_position(sequence_buffer[index]);
 			
 			float value = float(index) / float(width * height - 1);
 			
@@ -278,7 +839,7 @@
 	};
 	
 	layout(binding = 0, set = 1) uniform texture2D in_texture;
-	layout(binding = 1, set = 1, r32f) uniform writeonly image2D out_surface;
+	layout(binding = 1, set = 1, NOISE_FORMAT) uniform writeonly image2D out_surface;
 	
 	/*
 	 */
@@ -297,12 +858,124 @@
 		}
 	}
 	
+#elif READBACK_SHADER
+	
+	layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+	
+	layout(std430, binding = 0) writeonly buffer ReadbackBuffer { uint readback_buffer[]; };
+	
+	layout(binding = 0, set = 1) uniform texture2D in_texture;
+	
+	/*
+	 */
+	void main() {
+		
+		ivec2 size = textureSize(in_texture, 0);
+		ivec2 global_id = ivec2(gl_GlobalInvocationID.xy);
+		
+		// every thread packs one word of the output row
+		// the buffer rows are aligned to words
+		const int texels = 32 / OUTPUT_BITS;
+		int pitch = (size.x + texels - 1) / texels;
+		if(global_id.x < pitch && global_id.y < size.y) {
+			
+			uint word = 0u;
+			for(int i = 0; i < texels; i++) {
+				int x = global_id.x * texels + i;
+				if(x >= size.x) break;
+				float value = texelFetch(in_texture, ivec2(x, global_id.y), 0).x;
+				#if OUTPUT_BITS == 32
+					word = floatBitsToUint(value);
+				#else
+					// the value is rounded to the unorm output level
+					word |= uint(floor(value * OUTPUT_SCALE + 0.5f)) << uint(OUTPUT_BITS * i);
+				#endif
+			}
+			
+			readback_buffer[pitch * global_id.y + global_id.x] = word;
+		}
+	}
+	
+#elif SLICE_SHADER
+	
+	layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+	
+	layout(std140, binding = 0) uniform SliceParameters {
+		int mode;
+		int slice;
+	};
+	
+	layout(binding = 0, set = 1) uniform texture2DArray in_texture;
+	layout(binding = 1, set = 1, r32f) uniform writeonly image2D out_surface;
+	
+	/*
+	 */
+	void main() {
+		
+		ivec2 surface_size = imageSize(out_surface);
+		ivec2 global_id = ivec2(gl_GlobalInvocationID.xy);
+		
+		if(all(lessThan(global_id, surface_size))) {
+			
+			// layer, XZ or ZY slice of the layered noise
+			ivec3 position = ivec3(global_id, slice);
+			if(mode == 1) position = ivec3(global_id.x, slice, global_id.y);
+			else if(mode == 2) position = ivec3(slice, global_id.y, global_id.x);
+			
+			float value = texelFetch(in_texture, position, 0).x;
+			
+			imageStore(out_surface, global_id, vec4(value, 0.0f, 0.0f, 0.0f));
+		}
+	}
+	
+#elif MAGNITUDE_SHADER
+	
+	layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+	
+	layout(std140, binding = 0) uniform MagnitudeParameters {
+		int logarithmic;
+	};
+	
+	layout(binding = 0, set = 1) uniform texture2D in_texture;
+	layout(binding = 1, set = 1, r32f) uniform writeonly image2D out_surface;
+	
+	/*
+	 */
+	void main() {
+		
+		ivec2 surface_size = imageSize(out_surface);
+		ivec2 global_id = ivec2(gl_GlobalInvocationID.xy);
+		
+		if(all(lessThan(global_id, surface_size))) {
+			
+			// centered spectrum
+			// the right half is mirrored from the half spectrum of the real transform
+			ivec2 half_size = surface_size / 2;
+			int x = (global_id.x <= half_size.x) ? global_id.x : surface_size.x - global_id.x;
+			int y = (global_id.y < half_size.y) ? global_id.y : global_id.y - half_size.y;
+			int offset = (global_id.y < half_size.y) ? half_size.y : surface_size.y;
+			
+			vec2 value = texelFetch(in_texture, ivec2(half_size.x - x, offset - y - 1), 0).xy;
+			
+			// the constant component is removed
+			float magnitude = length(value);
+			if(x == half_size.x && y == half_size.y - 1) magnitude = 0.0f;
+			if(logarithmic != 0) magnitude = log(1.0f + magnitude);
+			
+			imageStore(out_surface, global_id, vec4(magnitude, 0.0f, 0.0f, 0.0f));
+		}
+	}
+	
 #elif UPSCALE_SHADER
 	
 	layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
 	
-	layout(binding = 0, set = 0) uniform texture2D in_texture;
-	layout(binding = 1, set = 0, r32f) uniform writeonly image2D out_surface;
+	layout(std140, binding = 0) uniform UpscaleParameters {
+		float scale;
+	};
+	
+	layout(binding = 0, set = 1) uniform texture2D in_texture;
+	layout(binding = 1, set = 1, REAL_FORMAT) uniform writeonly image2D out_surface;
 	
 	/*
 	 */
@@ -318,9 +991,50 @@
 		if(position.y < offset.y) position.y += texture_size.y;
 		position = (position - offset) % texture_size;
 		
-		float value = texelFetch(in_texture, position, 0).x;
+		float value = texelFetch(in_texture, position, 0).x * scale;
 		
 		imageStore(out_surface, global_id, vec4(value, 0.0f, 0.0f, 0.0f));
 	}
 	
+#elif ENERGY_SHADER
+	
+	layout(local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+	
+	layout(std140, binding = 0) uniform EnergyParameters {
+		int size;
+		float value;
+		uint position_index;
+		uint count;
+	};
+	
+	layout(std430, binding = 1) readonly buffer PositionBuffer { uvec2 position_buffer[]; };
+	layout(std430, binding = 2) readonly buffer IterationBuffer { uint index; int step; uint inserted; uint converged; uint selected; };
+	
+	layout(binding = 0, set = 1) uniform texture2D in_texture;
+	layout(binding = 1, set = 1, REAL_FORMAT) uniform image2D out_surface;
+	
+	/*
+	 */
+	void main() {
+		
+		ivec2 surface_size = imageSize(out_surface);
+		ivec2 global_id = ivec2(gl_GlobalInvocationID.xy);
+		
+		// the positions after the selection count are not committed
+		if(all(lessThan(global_id, ivec2(size))) && (count == 1u || position_index < selected)) {
+			
+			// wrap-around kernel offset
+			ivec2 offset = global_id - size / 2;
+			ivec2 position = (unpack_position(position_buffer[position_index].x) + offset + surface_size) % surface_size;
+			float weight = texelFetch(in_texture, (offset + surface_size) % surface_size, 0).x;
+			
+			// update energy
+			float energy = imageLoad(out_surface, position).x;
+			if(value > 0.5f) energy += weight;
+			else energy -= weight;
+			
+			imageStore(out_surface, position, vec4(energy, 0.0f, 0.0f, 0.0f));
+		}
+	}
+	
 #endif
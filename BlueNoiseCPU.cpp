@@ -0,0 +1,820 @@
+// MIT License
+// 
+// Copyright (C) 2018-2023, Tellusim Technologies Inc. https://tellusim.com/
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#if defined(__SSE2__) || defined(_M_X64)
+	#include <emmintrin.h>
+	#define NOISE_SSE2	1
+#endif
+
+#include <core/TellusimLog.h>
+#include <core/TellusimTime.h>
+#include <math/TellusimMath.h>
+
+#include "BlueNoiseCPU.h"
+
+/*
+ */
+namespace Tellusim {
+	
+	/*
+	 */
+	class BlueNoiseCPU::Worker : public Thread {
+			
+		public:
+			
+			Worker(BlueNoiseCPU *noise, uint32_t index, uint32_t begin, uint32_t end) : noise(noise), index(index), begin(begin), end(end) { }
+			
+			/// dispatch rows on every pass
+			virtual void process() {
+				uint32_t current = 0;
+				while(noise->wait_pass(current)) {
+					
+					// dispatch rows
+					noise->dispatch_rows(begin, end, noise->results[index]);
+					noise->finish_pass();
+				}
+			}
+			
+		private:
+			
+			BlueNoiseCPU *noise = nullptr;	// noise generator
+			uint32_t index = 0;				// result index
+			uint32_t begin = 0;				// begin row
+			uint32_t end = 0;				// end row
+	};
+	
+	/*
+	 */
+	BlueNoiseCPU::BlueNoiseCPU() {
+		
+	}
+	
+	BlueNoiseCPU::~BlueNoiseCPU() {
+		stop_workers();
+	}
+	
+	/*
+	 */
+	void BlueNoiseCPU::setEnergyRadius(float32_t radius) {
+		energy_radius = max(radius, 0.0f);
+	}
+	
+	/*
+	 */
+	bool BlueNoiseCPU::create(uint32_t w, uint32_t h, uint32_t layers, uint32_t threads) {
+		
+		// check size
+		if(w < MinSize || h < MinSize) {
+			TS_LOGF(Error, "BlueNoiseCPU::create(): invalid size %ux%u\n", w, h);
+			return false;
+		}
+		
+		width = w;
+		height = h;
+		
+		// worker rows
+		// workers spin for a short time between passes, so they are limited by the number of processors
+		// small images don't benefit from additional threads
+		num_threads = (threads) ? min(threads, Thread::getNumCPUs()) : Thread::getNumCPUs();
+		num_threads = clamp(num_threads, 1u, max(height / MinRows, 1u));
+		
+		// create buffers
+		uint32_t num_pixels = width * height;
+		kernel.resize(num_pixels);
+		pattern.resize(num_pixels);
+		energy.resize(num_pixels);
+		copy_pattern.resize(num_pixels);
+		copy_energy.resize(num_pixels);
+		sequence.resize(num_pixels);
+		kernel_spectrum.resize(num_pixels);
+		spectrum.resize(num_pixels * 2);
+		
+		return true;
+	}
+	
+	/*
+	 */
+	bool BlueNoiseCPU::start_workers() {
+		
+		stop_workers();
+		
+		generation.set(0);
+		finished.set(0);
+		stopping.set(0);
+		num_workers = 0;
+		results.resize(num_threads);
+		
+		// the calling thread dispatches the first rows
+		for(uint32_t i = 1; i < num_threads; i++) {
+			uint32_t begin = height * i / num_threads;
+			uint32_t end = height * (i + 1) / num_threads;
+			Worker *worker = new Worker(this, i, begin, end);
+			if(!worker->run()) {
+				TS_LOG(Error, "BlueNoiseCPU::start_workers(): can't run worker\n");
+				delete worker;
+				return false;
+			}
+			workers.append(worker);
+		}
+		num_workers = workers.size();
+		
+		return true;
+	}
+	
+	void BlueNoiseCPU::stop_workers() {
+		
+		if(!workers) return;
+		
+		// wake up workers
+		{
+			std::lock_guard<std::mutex> lock(pass_mutex);
+			stopping.set(1);
+			generation.fetchAdd(1);
+			pass_condition.notify_all();
+		}
+		for(Worker *worker : workers) {
+			worker->stop();
+			delete worker;
+		}
+		workers.clear();
+		num_workers = 0;
+	}
+	
+	/*
+	 */
+	bool BlueNoiseCPU::wait_pass(uint32_t &current) {
+		
+		// wait for the next pass
+		// passes are short, so the worker spins for a while before it blocks
+		for(uint32_t i = 0; i < SpinCount && generation.get() == current; i++) { }
+		if(generation.get() == current) {
+			std::unique_lock<std::mutex> lock(pass_mutex);
+			while(generation.get() == current) pass_condition.wait(lock);
+		}
+		current = generation.get();
+		
+		return (stopping.get() == 0);
+	}
+	
+	void BlueNoiseCPU::finish_pass() {
+		
+		// the last worker wakes up the dispatching thread
+		finished.fetchAdd(1);
+		if(finished.get() == num_workers) {
+			std::lock_guard<std::mutex> lock(pass_mutex);
+			finished_condition.notify_one();
+		}
+	}
+	
+	/*
+	 */
+	static inline int32_t get_key(float32_t value) {
+		
+		// ordered integer key of the float weight
+		// the keys are compared as integers without the floating-point ordering rules
+		union { float32_t f; int32_t i; } bits = { value };
+		return bits.i ^ ((bits.i >> 31) & 0x7fffffff);
+	}
+	
+	#if NOISE_SSE2
+		
+		static inline __m128i get_key(__m128 value) {
+			__m128i bits = _mm_castps_si128(value);
+			return _mm_xor_si128(bits, _mm_and_si128(_mm_srai_epi32(bits, 31), _mm_set1_epi32(0x7fffffff)));
+		}
+		
+		static inline __m128i get_min(__m128i a, __m128i b) {
+			__m128i mask = _mm_cmplt_epi32(a, b);
+			return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+		}
+		
+		static inline __m128i get_max(__m128i a, __m128i b) {
+			__m128i mask = _mm_cmpgt_epi32(a, b);
+			return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+		}
+		
+	#endif
+	
+	/*
+	 */
+	static void update_energy(float32_t *energy, const float32_t *kernel, float32_t value, uint32_t size) {
+		
+		uint32_t x = 0;
+		
+		// four pixels per step
+		#if NOISE_SSE2
+			__m128 value_4 = _mm_set1_ps(value);
+			for(; x + 4 <= size; x += 4) {
+				__m128 energy_4 = _mm_loadu_ps(energy + x);
+				_mm_storeu_ps(energy + x, _mm_add_ps(energy_4, _mm_mul_ps(value_4, _mm_loadu_ps(kernel + x))));
+			}
+		#endif
+		
+		for(; x < size; x++) {
+			energy[x] += value * kernel[x];
+		}
+	}
+	
+	static int32_t get_min_key(const float32_t *energy, const float32_t *pattern, float32_t mask, uint32_t size) {
+		
+		int32_t key = get_key(mask);
+		uint32_t x = 0;
+		
+		// four keys per step
+		// the lane minimums are reduced after the row
+		#if NOISE_SSE2
+			if(size >= 4) {
+				__m128 mask_4 = _mm_set1_ps(mask);
+				__m128i key_4 = _mm_set1_epi32(key);
+				for(; x + 4 <= size; x += 4) {
+					__m128 weight_4 = _mm_add_ps(_mm_loadu_ps(energy + x), _mm_mul_ps(_mm_loadu_ps(pattern + x), mask_4));
+					key_4 = get_min(key_4, get_key(weight_4));
+				}
+				int32_t keys[4];
+				_mm_storeu_si128((__m128i*)keys, key_4);
+				key = min(min(keys[0], keys[1]), min(keys[2], keys[3]));
+			}
+		#endif
+		
+		for(; x < size; x++) {
+			key = min(key, get_key(energy[x] + pattern[x] * mask));
+		}
+		
+		return key;
+	}
+	
+	static int32_t get_max_key(const float32_t *energy, const float32_t *pattern, float32_t mask, uint32_t size) {
+		
+		int32_t key = get_key(-mask);
+		uint32_t x = 0;
+		
+		// four keys per step
+		// the lane maximums are reduced after the row
+		#if NOISE_SSE2
+			if(size >= 4) {
+				__m128 one_4 = _mm_set1_ps(1.0f);
+				__m128 mask_4 = _mm_set1_ps(mask);
+				__m128i key_4 = _mm_set1_epi32(key);
+				for(; x + 4 <= size; x += 4) {
+					__m128 weight_4 = _mm_sub_ps(_mm_loadu_ps(energy + x), _mm_mul_ps(_mm_sub_ps(one_4, _mm_loadu_ps(pattern + x)), mask_4));
+					key_4 = get_max(key_4, get_key(weight_4));
+				}
+				int32_t keys[4];
+				_mm_storeu_si128((__m128i*)keys, key_4);
+				key = max(max(keys[0], keys[1]), max(keys[2], keys[3]));
+			}
+		#endif
+		
+		for(; x < size; x++) {
+			key = max(key, get_key(energy[x] - (1.0f - pattern[x]) * mask));
+		}
+		
+		return key;
+	}
+	
+	/*
+	 */
+	void BlueNoiseCPU::dispatch_rows(uint32_t begin, uint32_t end, Result &result) {
+		
+		// masked pixels are moved out of the sample range
+		const float32_t mask = 1e30f;
+		const int32_t min_key = get_key(-mask);
+		const int32_t max_key = get_key(mask);
+		
+		result.key = (update_sample == SampleMax) ? min_key : max_key;
+		result.index = Maxu32;
+		
+		uint32_t update_x = update_index % width;
+		uint32_t update_y = update_index / width;
+		int32_t window = (int32_t)energy_window;
+		
+		for(uint32_t y = begin; y < end; y++) {
+			float32_t *energy_row = energy_data + width * y;
+			const float32_t *pattern_row = pattern_data + width * y;
+			
+			// energy update
+			// the kernel row is split at the wrap-around seam into two contiguous ranges
+			if(update_index != Maxu32) {
+				uint32_t kernel_y = (y + height - update_y) % height;
+				int32_t distance = (int32_t)min(kernel_y, height - kernel_y);
+				if(!window) {
+					const float32_t *kernel_row = kernel.get() + width * kernel_y;
+					update_energy(energy_row, kernel_row + width - update_x, update_value, update_x);
+					update_energy(energy_row + update_x, kernel_row, update_value, width - update_x);
+				} else if(distance <= window) {
+					const float32_t *kernel_row = kernel.get() + width * kernel_y;
+					for(int32_t i = -window; i <= window; i++) {
+						uint32_t x = (update_x + width + i) % width;
+						energy_row[x] += update_value * kernel_row[(width + i) % width];
+					}
+				}
+			}
+			
+			// sample scan
+			// the masked integer reduction has no branches and the position is only searched in a better row
+			if(update_sample == SampleMin) {
+				int32_t key = get_min_key(energy_row, pattern_row, mask, width);
+				if(key < result.key) {
+					for(uint32_t x = 0; x < width; x++) {
+						if(get_key(energy_row[x] + pattern_row[x] * mask) != key) continue;
+						result.key = key;
+						result.index = width * y + x;
+						break;
+					}
+				}
+			} else if(update_sample == SampleMax) {
+				int32_t key = get_max_key(energy_row, pattern_row, mask, width);
+				if(key > result.key) {
+					for(uint32_t x = 0; x < width; x++) {
+						if(get_key(energy_row[x] - (1.0f - pattern_row[x]) * mask) != key) continue;
+						result.key = key;
+						result.index = width * y + x;
+						break;
+					}
+				}
+			}
+		}
+		
+		// masked pixels are not valid samples
+		if(result.key > get_key(mask * 0.5f) || result.key < get_key(-mask * 0.5f)) result.index = Maxu32;
+	}
+	
+	/*
+	 */
+	uint32_t BlueNoiseCPU::dispatch_pass(uint32_t index, float32_t value, Sample sample) {
+		
+		update_index = index;
+		update_value = value;
+		update_sample = sample;
+		
+		// dispatch workers
+		finished.set(0);
+		if(workers) {
+			std::lock_guard<std::mutex> lock(pass_mutex);
+			generation.fetchAdd(1);
+			pass_condition.notify_all();
+		}
+		dispatch_rows(0, height / num_threads, results[0]);
+		
+		// wait for workers
+		for(uint32_t i = 0; i < SpinCount && finished.get() != num_workers; i++) { }
+		if(finished.get() != num_workers) {
+			std::unique_lock<std::mutex> lock(pass_mutex);
+			while(finished.get() != num_workers) finished_condition.wait(lock);
+		}
+		
+		// the first result with the best weight matches the row order of a single thread
+		Result &result = results[0];
+		for(uint32_t i = 1; i < results.size(); i++) {
+			if(results[i].index == Maxu32) continue;
+			bool better = (sample == SampleMin) ? (results[i].key < result.key) : (results[i].key > result.key);
+			if(result.index == Maxu32 || better) result = results[i];
+		}
+		
+		return result.index;
+	}
+	
+	/*
+	 */
+	static bool is_transform_size(uint32_t size) {
+		
+		// the size has only 2, 3, 5 and 7 factors
+		static const uint32_t radices[] = { 2, 3, 5, 7 };
+		if(size == 0) return false;
+		for(uint32_t radix : radices) {
+			while(size % radix == 0) size /= radix;
+		}
+		
+		return (size == 1);
+	}
+	
+	/*
+	 */
+	static void dispatch_fft(float32_t *data, uint32_t size, uint32_t stride, Array<float32_t> &buffer) {
+		
+		// transform radices
+		// the radix-4 steps go first and the size is a transform size
+		static const uint32_t factors[] = { 4, 2, 3, 5, 7 };
+		uint32_t radices[32];
+		uint32_t num_radices = 0;
+		uint32_t remain = size;
+		for(uint32_t factor : factors) {
+			while(remain % factor == 0) {
+				radices[num_radices++] = factor;
+				remain /= factor;
+			}
+		}
+		
+		// gather values
+		buffer.resize(size * 4);
+		float32_t *src = buffer.get();
+		float32_t *dest = src + size * 2;
+		for(uint32_t i = 0; i < size; i++) {
+			src[i * 2 + 0] = data[stride * i * 2 + 0];
+			src[i * 2 + 1] = data[stride * i * 2 + 1];
+		}
+		
+		// Stockham radix steps
+		// every step reads the values at the size / radix distance and writes the sorted outputs, so there is no permutation pass
+		uint32_t span = 1;
+		for(uint32_t i = 0; i < num_radices; i++) {
+			uint32_t radix = radices[i];
+			uint32_t step = size / radix;
+			
+			// radix roots
+			float32_t roots[8 * 2];
+			for(uint32_t j = 0; j < radix; j++) {
+				float64_t angle = -6.283185307179586 * j / radix;
+				roots[j * 2 + 0] = (float32_t)cos(angle);
+				roots[j * 2 + 1] = (float32_t)sin(angle);
+			}
+			
+			for(uint32_t j = 0; j < step; j++) {
+				uint32_t k = j % span;
+				
+				// twiddled inputs
+				float64_t angle = -6.283185307179586 * k / (span * radix);
+				float64_t twiddle_c = cos(angle);
+				float64_t twiddle_s = sin(angle);
+				float64_t c = 1.0;
+				float64_t s = 0.0;
+				float32_t values[8 * 2];
+				for(uint32_t r = 0; r < radix; r++) {
+					const float32_t *value = src + (step * r + j) * 2;
+					values[r * 2 + 0] = (float32_t)(value[0] * c - value[1] * s);
+					values[r * 2 + 1] = (float32_t)(value[0] * s + value[1] * c);
+					float64_t t = c * twiddle_c - s * twiddle_s;
+					s = c * twiddle_s + s * twiddle_c;
+					c = t;
+				}
+				
+				// radix butterfly
+				float32_t *output = dest + ((j / span) * span * radix + k) * 2;
+				for(uint32_t q = 0; q < radix; q++) {
+					float32_t r0 = 0.0f;
+					float32_t i0 = 0.0f;
+					for(uint32_t r = 0, e = 0; r < radix; r++) {
+						const float32_t *root = roots + e * 2;
+						r0 += values[r * 2 + 0] * root[0] - values[r * 2 + 1] * root[1];
+						i0 += values[r * 2 + 0] * root[1] + values[r * 2 + 1] * root[0];
+						e += q;
+						if(e >= radix) e -= radix;
+					}
+					output[span * q * 2 + 0] = r0;
+					output[span * q * 2 + 1] = i0;
+				}
+			}
+			
+			float32_t *temp = src;
+			src = dest;
+			dest = temp;
+			span *= radix;
+		}
+		
+		// scatter values
+		for(uint32_t i = 0; i < size; i++) {
+			data[stride * i * 2 + 0] = src[i * 2 + 0];
+			data[stride * i * 2 + 1] = src[i * 2 + 1];
+		}
+	}
+	
+	static void dispatch_transform(float32_t *data, uint32_t width, uint32_t height) {
+		
+		// the rows and the columns are transformed with the same mixed-radix steps
+		Array<float32_t> buffer;
+		for(uint32_t y = 0; y < height; y++) {
+			dispatch_fft(data + width * y * 2, width, 1, buffer);
+		}
+		for(uint32_t x = 0; x < width; x++) {
+			dispatch_fft(data + x * 2, height, width, buffer);
+		}
+	}
+	
+	/*
+	 */
+	void BlueNoiseCPU::create_energy() {
+		
+		uint32_t num_pixels = width * height;
+		
+		// the truncated kernel window is accumulated per position
+		if(energy_window) {
+			for(uint32_t i = 0; i < num_pixels; i++) {
+				energy_data[i] = 0.0f;
+			}
+			for(uint32_t i = 0; i < num_pixels; i++) {
+				if(pattern_data[i] > 0.5f) dispatch_pass(i, 1.0f, SampleNone);
+			}
+			return;
+		}
+		
+		// pattern spectrum
+		for(uint32_t i = 0; i < num_pixels; i++) {
+			spectrum[i * 2 + 0] = pattern_data[i];
+			spectrum[i * 2 + 1] = 0.0f;
+		}
+		dispatch_transform(spectrum.get(), width, height);
+		
+		// filter the pattern spectrum
+		// the inverse transform is the forward transform of the conjugated spectrum
+		float32_t scale = 1.0f / num_pixels;
+		for(uint32_t i = 0; i < num_pixels; i++) {
+			float32_t k = kernel_spectrum[i] * scale;
+			spectrum[i * 2 + 0] *= k;
+			spectrum[i * 2 + 1] *= -k;
+		}
+		dispatch_transform(spectrum.get(), width, height);
+		
+		// the energy is the real part of the circular convolution
+		for(uint32_t i = 0; i < num_pixels; i++) {
+			energy_data[i] = spectrum[i * 2];
+		}
+	}
+	
+	/*
+	 */
+	Image BlueNoiseCPU::dispatch(const Image &image, uint32_t layers, float32_t sigma, float32_t epsilon) {
+		
+		Array<Image> noise_images = dispatch(Array<Image>({ image }), layers, sigma, epsilon);
+		if(!noise_images) return Image();
+		
+		return noise_images[0];
+	}
+	
+	Array<Image> BlueNoiseCPU::dispatch(const Array<Image> &images, uint32_t layers, float32_t sigma, float32_t epsilon) {
+		
+		// check image size
+		if(layers < 1) {
+			TS_LOGF(Error, "BlueNoiseCPU::dispatch(): invalid layers %u\n", layers);
+			return Array<Image>();
+		}
+		for(const Image &image : images) {
+			if(image.getWidth() != width || image.getHeight() != height) {
+				TS_LOGF(Error, "BlueNoiseCPU::dispatch(): invalid image size %ux%u\n", image.getWidth(), image.getHeight());
+				return Array<Image>();
+			}
+		}
+		
+		// current time
+		uint64_t begin = Time::current();
+		
+		// generate wrap-around kernel
+		// the kernel matches the GPU kernel on power of two sizes and wraps at the true size otherwise
+		float64_t weight = 0.0;
+		float32_t isigma = 1.0f / (sigma * sigma + 1e-6f);
+		for(uint32_t y = 0; y < height; y++) {
+			float32_t dy = (float32_t)min(y, height - y);
+			for(uint32_t x = 0; x < width; x++) {
+				float32_t dx = (float32_t)min(x, width - x);
+				float32_t d = dx * dx + dy * dy;
+				float32_t k = exp(-d * isigma) + epsilon / (1.0f + d);
+				kernel[width * y + x] = k;
+				weight += k;
+			}
+		}
+		float32_t iweight = (float32_t)(width / weight);
+		for(float32_t &k : kernel) {
+			k *= iweight;
+		}
+		float64_t kernel_sum = weight * iweight;
+		
+		// truncated energy window
+		energy_window = 0;
+		if(energy_radius > 0.0f) {
+			energy_window = (uint32_t)ceil(sigma * energy_radius);
+			if(energy_window * 2 + 1 >= min(width, height)) energy_window = 0;
+		}
+		
+		// check transform size
+		// the exact kernel energy is transformed at the true size, so the size can't be padded
+		if(!energy_window && (!is_transform_size(width) || !is_transform_size(height))) {
+			TS_LOGF(Error, "BlueNoiseCPU::dispatch(): invalid transform size %ux%u, the size factors are limited to 2, 3, 5 and 7 without the energy radius\n", width, height);
+			return Array<Image>();
+		}
+		
+		// kernel spectrum
+		// the symmetric wrap-around kernel has the real spectrum
+		uint32_t num_pixels = width * height;
+		if(!energy_window) {
+			for(uint32_t i = 0; i < num_pixels; i++) {
+				spectrum[i * 2 + 0] = kernel[i];
+				spectrum[i * 2 + 1] = 0.0f;
+			}
+			dispatch_transform(spectrum.get(), width, height);
+			for(uint32_t i = 0; i < num_pixels; i++) {
+				kernel_spectrum[i] = spectrum[i * 2];
+			}
+		}
+		
+		// start workers
+		if(!start_workers()) return Array<Image>();
+		
+		Array<Image> noise_images;
+		uint32_t half_pixels = num_pixels / 2;
+		for(uint32_t i = 0; i < images.size(); i++) {
+			
+			// create noise image
+			Image noise_image;
+			if(!noise_image.create2D(FormatRf32, width, height, layers)) {
+				TS_LOG(Error, "BlueNoiseCPU::dispatch(): can't create noise image\n");
+				stop_workers();
+				return Array<Image>();
+			}
+			
+			// input pattern
+			uint32_t num_positions = 0;
+			Image input_image = images[i].toFormat(FormatRf32);
+			const uint8_t *input_data = input_image.getData();
+			size_t input_stride = input_image.getStride();
+			for(uint32_t y = 0; y < height; y++) {
+				const float32_t *input_row = (const float32_t*)(input_data + input_stride * y);
+				float32_t *pattern_row = pattern.get() + width * y;
+				for(uint32_t x = 0; x < width; x++) {
+					float32_t value = (input_row[x] > 0.5f) ? 1.0f : 0.0f;
+					pattern_row[x] = value;
+					num_positions += (uint32_t)value;
+				}
+			}
+			
+			// create initial energy
+			pattern_data = pattern.get();
+			energy_data = energy.get();
+			create_energy();
+			
+			// create initial sequence
+			// the inserted void is followed by the removed cluster
+			uint32_t progress_pixels = (num_positions * 2 + num_pixels * layers) * images.size();
+			uint32_t progress_base = (num_positions * 2 + num_pixels * layers) * i;
+			uint32_t index = dispatch_pass(Maxu32, 0.0f, SampleMin);
+			for(uint32_t j = 0; j < num_positions && index != Maxu32; j++) {
+				pattern[index] = 1.0f;
+				index = dispatch_pass(index, 1.0f, SampleMax);
+				pattern[index] = 0.0f;
+				index = dispatch_pass(index, -1.0f, SampleMin);
+				print_progress((uint32_t)((progress_base + j * 2) * 10000ull / progress_pixels), begin);
+			}
+			progress_base += num_positions * 2;
+			
+			// create noise layers
+			for(uint32_t l = 0; l < layers; l++, progress_base += num_pixels) {
+				
+				// first phase
+				copy_pattern = pattern;
+				copy_energy = energy;
+				pattern_data = copy_pattern.get();
+				energy_data = copy_energy.get();
+				index = dispatch_pass(Maxu32, 0.0f, SampleMax);
+				for(uint32_t j = 0; j < num_positions; j++) {
+					sequence[num_positions - j - 1] = index;
+					pattern_data[index] = 0.0f;
+					index = dispatch_pass(index, -1.0f, SampleMax);
+				}
+				
+				// second phase
+				pattern_data = pattern.get();
+				energy_data = energy.get();
+				index = dispatch_pass(Maxu32, 0.0f, SampleMin);
+				for(uint32_t j = num_positions; j < half_pixels; j++) {
+					sequence[j] = index;
+					pattern_data[index] = 1.0f;
+					index = dispatch_pass(index, 1.0f, SampleMin);
+					print_progress((uint32_t)((progress_base + j) * 10000ull / progress_pixels), begin);
+				}
+				
+				// third phase
+				// the energy of the inverse pattern is the kernel sum minus the pattern energy
+				for(uint32_t j = 0; j < num_pixels; j++) {
+					copy_pattern[j] = 1.0f - pattern[j];
+					copy_energy[j] = (float32_t)kernel_sum - energy[j];
+				}
+				pattern_data = copy_pattern.get();
+				energy_data = copy_energy.get();
+				index = dispatch_pass(Maxu32, 0.0f, SampleMax);
+				for(uint32_t j = half_pixels; j < num_pixels; j++) {
+					sequence[j] = index;
+					pattern_data[index] = 0.0f;
+					index = dispatch_pass(index, -1.0f, (j + 1 < num_pixels) ? SampleMax : SampleNone);
+					print_progress((uint32_t)((progress_base + j) * 10000ull / progress_pixels), begin);
+				}
+				
+				// render noise
+				ImageSampler noise_sampler(noise_image, Layer(l));
+				uint8_t *noise_data = noise_sampler.getData();
+				size_t noise_stride = noise_sampler.getStride();
+				for(uint32_t j = 0; j < num_pixels; j++) {
+					float32_t *noise_row = (float32_t*)(noise_data + noise_stride * (sequence[j] / width));
+					noise_row[sequence[j] % width] = (float32_t)j / (float32_t)(num_pixels - 1);
+				}
+				
+				// next layer
+				// the mirrored inverse ranks seed the next layer
+				if(l + 1 < layers) {
+					float32_t threshold = (float32_t)num_positions / (float32_t)num_pixels;
+					for(uint32_t y = 0; y < height; y++) {
+						const float32_t *noise_row = (const float32_t*)(noise_data + noise_stride * (height - y - 1));
+						float32_t *pattern_row = pattern.get() + width * y;
+						for(uint32_t x = 0; x < width; x++) {
+							float32_t value = 1.0f - noise_row[width - x - 1];
+							pattern_row[x] = (value < threshold) ? 1.0f : 0.0f;
+						}
+					}
+					pattern_data = pattern.get();
+					energy_data = energy.get();
+					create_energy();
+				}
+			}
+			
+			noise_images.append(noise_image);
+		}
+		
+		// stop workers
+		stop_workers();
+		
+		// done
+		print_progress(10000, begin);
+		Log::print("\n");
+		
+		return noise_images;
+	}
+	
+	/*
+	 */
+	Image BlueNoiseCPU::dispatchForward(const Image &image) {
+		
+		// check image size
+		uint32_t width = image.getWidth();
+		uint32_t height = image.getHeight();
+		if(!ispot(width) || !ispot(height)) {
+			TS_LOGF(Error, "BlueNoiseCPU::dispatchForward(): invalid image size %ux%x\n", width, height);
+			return Image();
+		}
+		
+		// complex image
+		Array<float32_t> data;
+		data.resize(width * height * 2, 0.0f);
+		Image input_image = image.toFormat(FormatRf32);
+		ImageSampler image_sampler(input_image);
+		for(uint32_t y = 0; y < height; y++) {
+			for(uint32_t x = 0; x < width; x++) {
+				data[(width * y + x) * 2] = image_sampler.get2D(x, y).f.r;
+			}
+		}
+		
+		// forward transform
+		dispatch_transform(data.get(), width, height);
+		
+		// create forward image
+		Image forward_image;
+		forward_image.create2D(FormatRf32, width, height);
+		ImageSampler forward_sampler(forward_image);
+		
+		// convert forward image
+		// the layout matches the half spectrum conversion of the GPU generator
+		uint32_t width_2 = width / 2;
+		uint32_t height_2 = height / 2;
+		for(uint32_t y = 0; y < height_2; y++) {
+			for(uint32_t x = 0; x < width_2 + 1; x++) {
+				if(x == width_2 && y == height_2 - 1) continue;
+				const float32_t *value_0 = data.get() + (width * (height_2 - y - 1) + width_2 - x) * 2;
+				const float32_t *value_1 = data.get() + (width * (height - y - 1) + width_2 - x) * 2;
+				ImageColor pixel_0(sqrt(value_0[0] * value_0[0] + value_0[1] * value_0[1]));
+				ImageColor pixel_1(sqrt(value_1[0] * value_1[0] + value_1[1] * value_1[1]));
+				forward_sampler.set2D(x, y, pixel_0);
+				forward_sampler.set2D(x, height_2 + y, pixel_1);
+				if(x) forward_sampler.set2D(width - x, y, pixel_0);
+				if(x) forward_sampler.set2D(width - x, height_2 + y, pixel_1);
+			}
+		}
+		
+		return forward_image;
+	}
+	
+	/*
+	 */
+	void BlueNoiseCPU::print_progress(uint32_t progress, uint64_t begin) {
+		uint64_t time = Time::current();
+		if(time - old_time > Time::Seconds / 10) {
+			uint64_t remain = (time - begin) * (10000 - min(progress, 10000u)) / max(progress, 1u);
+			Log::printf("\rProgress: %4.1f %% Time: %s Remain: %s                \r", progress / 100.0f, String::fromTime(time - begin).get(), String::fromTime(remain).get());
+			old_time = time;
+		}
+	}
+}
@@ -0,0 +1,145 @@
+// MIT License
+// 
+// Copyright (C) 2018-2023, Tellusim Technologies Inc. https://tellusim.com/
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __NOISE_BLUE_NOISE_CPU_H__
+#define __NOISE_BLUE_NOISE_CPU_H__
+
+#include <mutex>
+#include <condition_variable>
+
+#include <core/TellusimThread.h>
+#include <format/TellusimImage.h>
+
+/*
+ */
+namespace Tellusim {
+	
+	/*
+	 */
+	class BlueNoiseCPU {
+			
+		public:
+			
+			BlueNoiseCPU();
+			~BlueNoiseCPU();
+			
+			/// create noise generator
+			/// threads is the number of worker threads, zero uses all processors
+			bool create(uint32_t width, uint32_t height, uint32_t layers, uint32_t threads = 0);
+			
+			/// energy parameters
+			/// radius is the truncated kernel radius in sigma units, zero keeps the exact wrap-around kernel
+			void setEnergyRadius(float32_t radius);
+			float32_t getEnergyRadius() const { return energy_radius; }
+			
+			/// dispatch noise generator
+			Image dispatch(const Image &image, uint32_t layers, float32_t sigma, float32_t epsilon);
+			
+			/// dispatch noise generator for multiple images
+			Array<Image> dispatch(const Array<Image> &images, uint32_t layers, float32_t sigma, float32_t epsilon);
+			
+			/// dispatch forward transform
+			Image dispatchForward(const Image &image);
+			
+		private:
+			
+			class Worker;
+			
+			/// sample types
+			enum Sample {
+				SampleNone = 0,
+				SampleMin,
+				SampleMax,
+			};
+			
+			/// sample result
+			struct Result {
+				int32_t key = 0;			// ordered sample weight
+				uint32_t index = Maxu32;	// sample index
+			};
+			
+			/// dispatch energy update and sample scan over the rows
+			void dispatch_rows(uint32_t begin, uint32_t end, Result &result);
+			
+			/// dispatch energy update and sample scan
+			uint32_t dispatch_pass(uint32_t index, float32_t value, Sample sample);
+			
+			/// create the energy of the current pattern
+			/// the exact kernel energy is the circular convolution of the pattern with the kernel spectrum
+			void create_energy();
+			
+			/// start and stop worker threads
+			bool start_workers();
+			void stop_workers();
+			
+			/// wait for the next pass and finish the pass in the worker thread
+			bool wait_pass(uint32_t &current);
+			void finish_pass();
+			
+			/// print progress
+			void print_progress(uint32_t progress, uint64_t begin);
+			
+			enum {
+				MinSize				= 1,
+				MinRows				= 16,
+				SpinCount			= 1 << 12,
+			};
+			
+			uint32_t width = 0;				// noise width
+			uint32_t height = 0;			// noise height
+			uint32_t num_threads = 0;		// number of threads
+			
+			float32_t energy_radius = 0.0f;	// energy kernel radius
+			uint32_t energy_window = 0;		// energy window radius
+			
+			Array<float32_t> kernel;		// wrap-around kernel
+			Array<float32_t> pattern;		// binary noise pattern
+			Array<float32_t> energy;		// energy of the pattern
+			Array<float32_t> copy_pattern;	// copy noise pattern
+			Array<float32_t> copy_energy;	// copy energy
+			Array<uint32_t> sequence;		// noise sequence
+			Array<float32_t> kernel_spectrum;	// real kernel spectrum
+			Array<float32_t> spectrum;		// complex transform buffer
+			
+			float32_t *pattern_data = nullptr;	// current pattern
+			float32_t *energy_data = nullptr;	// current energy
+			
+			uint32_t update_index = Maxu32;	// updated pixel index
+			float32_t update_value = 0.0f;	// updated pixel delta
+			Sample update_sample = SampleNone;	// sample type
+			
+			Array<Worker*> workers;			// worker threads
+			Array<Result> results;			// worker results
+			Atomic<uint32_t> generation;	// pass generation
+			Atomic<uint32_t> finished;		// finished workers
+			Atomic<uint32_t> stopping;		// stop request
+			uint32_t num_workers = 0;		// number of workers
+			
+			std::mutex pass_mutex;						// pass mutex
+			std::condition_variable pass_condition;		// next pass condition
+			std::condition_variable finished_condition;	// finished pass condition
+			
+			uint64_t old_time = 0;			// old progress time
+	};
+}
+
+#endif /* __NOISE_BLUE_NOISE_CPU_H__ */
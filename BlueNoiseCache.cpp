@@ -0,0 +1,238 @@
+// MIT License
+// 
+// Copyright (C) 2018-2023, Tellusim Technologies Inc. https://tellusim.com/
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <core/TellusimLog.h>
+#include <core/TellusimFile.h>
+#include <core/TellusimDirectory.h>
+#include <math/TellusimMath.h>
+
+#include "BlueNoiseCache.h"
+
+/*
+ */
+namespace Tellusim {
+	
+	/*
+	 */
+	BlueNoiseCache::BlueNoiseCache() {
+		
+	}
+	
+	BlueNoiseCache::~BlueNoiseCache() {
+		
+	}
+	
+	/*
+	 */
+	bool BlueNoiseCache::create(const char *p) {
+		
+		path = String(p);
+		if(!Directory::isDirectory(path) && !Directory::createDirectory(path)) {
+			TS_LOGF(Error, "BlueNoiseCache::create(): can't create \"%s\" directory\n", p);
+			path = String();
+			return false;
+		}
+		
+		return true;
+	}
+	
+	/*
+	 */
+	static uint64_t get_hash(const void *data, size_t size, uint64_t hash) {
+		
+		// FNV-1a hash
+		const uint8_t *d = (const uint8_t*)data;
+		for(size_t i = 0; i < size; i++) {
+			hash = (hash ^ d[i]) * 0x100000001b3ull;
+		}
+		
+		return hash;
+	}
+	
+	uint64_t BlueNoiseCache::getKey(const char *parameters, const Image &image) {
+		
+		uint64_t hash = 0xcbf29ce484222325ull;
+		
+		// generation parameters
+		String parameters_string = String(parameters);
+		hash = get_hash(parameters_string.get(), parameters_string.size(), hash);
+		
+		// input image contents
+		// the input is binarized by the generator, so only the thresholded pixels contribute
+		uint32_t width = image.getWidth();
+		uint32_t height = image.getHeight();
+		Image input_image = image.toFormat(FormatRf32);
+		const uint8_t *input_data = input_image.getData();
+		size_t input_stride = input_image.getStride();
+		uint32_t size[2] = { width, height };
+		hash = get_hash(size, sizeof(size), hash);
+		for(uint32_t y = 0; y < height; y++) {
+			const float32_t *input_row = (const float32_t*)(input_data + input_stride * y);
+			uint8_t row[256];
+			for(uint32_t x = 0; x < width; x += 256) {
+				uint32_t count = min(width - x, 256u);
+				for(uint32_t i = 0; i < count; i++) {
+					row[i] = (input_row[x + i] > 0.5f) ? 1 : 0;
+				}
+				hash = get_hash(row, count, hash);
+			}
+		}
+		
+		return hash;
+	}
+	
+	/*
+	 */
+	String BlueNoiseCache::get_name(uint64_t key) const {
+		return path + String::format("/noise_%08x%08x.cache", (uint32_t)(key >> 32), (uint32_t)key);
+	}
+	
+	/*
+	 */
+	Image BlueNoiseCache::load(uint64_t key) const {
+		
+		if(!path) return Image();
+		
+		// open cache file
+		String name = get_name(key);
+		if(!File::isFile(name.get())) return Image();
+		File file;
+		if(!file.open(name.get(), "rb")) return Image();
+		
+		// cache header
+		if(file.readu32() != Magic || file.readu32() != Version) {
+			TS_LOGF(Warning, "BlueNoiseCache::load(): invalid cache file \"%s\"\n", name.get());
+			return Image();
+		}
+		uint32_t width = file.readu32();
+		uint32_t height = file.readu32();
+		uint32_t layers = file.readu32();
+		uint32_t num_pixels = width * height;
+		if(width < 1 || height < 1 || layers < 1) return Image();
+		
+		// create noise image
+		Image noise_image;
+		if(!noise_image.create2D(FormatRf32, width, height, layers)) return Image();
+		
+		// read ranks
+		// the rank values are reconstructed with the same expression as in the render kernel
+		bool compact = (num_pixels <= 0x10000);
+		Array<uint16_t> ranks_16;
+		Array<uint32_t> ranks_32;
+		for(uint32_t l = 0; l < layers; l++) {
+			size_t size = 0;
+			if(compact) {
+				ranks_16.resize(num_pixels);
+				size = file.read(ranks_16.get(), sizeof(uint16_t) * num_pixels);
+			} else {
+				ranks_32.resize(num_pixels);
+				size = file.read(ranks_32.get(), sizeof(uint32_t) * num_pixels);
+			}
+			if(size != ((compact) ? sizeof(uint16_t) : sizeof(uint32_t)) * num_pixels) {
+				TS_LOGF(Warning, "BlueNoiseCache::load(): can't read cache file \"%s\"\n", name.get());
+				return Image();
+			}
+			ImageSampler noise_sampler(noise_image, Layer(l));
+			uint8_t *data = noise_sampler.getData();
+			size_t stride = noise_sampler.getStride();
+			float32_t scale = 1.0f / (float32_t)max(num_pixels - 1, 1u);
+			for(uint32_t y = 0; y < height; y++) {
+				float32_t *row = (float32_t*)(data + stride * y);
+				for(uint32_t x = 0; x < width; x++) {
+					uint32_t i = width * y + x;
+					uint32_t rank = (compact) ? ranks_16[i] : ranks_32[i];
+					row[x] = (float32_t)rank * scale;
+				}
+			}
+		}
+		
+		return noise_image;
+	}
+	
+	/*
+	 */
+	bool BlueNoiseCache::save(uint64_t key, const Image &image) const {
+		
+		if(!path) return false;
+		
+		// the quantized ranks can't be restored
+		if(image.getFormat() != FormatRf32) {
+			TS_LOG(Error, "BlueNoiseCache::save(): the image is not float ranks\n");
+			return false;
+		}
+		
+		uint32_t width = image.getWidth();
+		uint32_t height = image.getHeight();
+		uint32_t layers = max(image.getLayers(), 1u);
+		uint32_t num_pixels = width * height;
+		
+		// the cache is written to a temporary file and renamed, so readers never see partial data
+		String name = get_name(key);
+		String temp_name = name + ".tmp";
+		File file;
+		if(!file.open(temp_name.get(), "wb")) {
+			TS_LOGF(Error, "BlueNoiseCache::save(): can't create cache file \"%s\"\n", temp_name.get());
+			return false;
+		}
+		
+		// cache header
+		bool status = file.writeu32(Magic);
+		status &= file.writeu32(Version);
+		status &= file.writeu32(width);
+		status &= file.writeu32(height);
+		status &= file.writeu32(layers);
+		
+		// write ranks
+		// 16-bit ranks are enough up to 256x256 pixels
+		bool compact = (num_pixels <= 0x10000);
+		Array<uint16_t> ranks_16;
+		Array<uint32_t> ranks_32;
+		for(uint32_t l = 0; status && l < layers; l++) {
+			if(compact) ranks_16.resize(num_pixels);
+			else ranks_32.resize(num_pixels);
+			ImageSampler noise_sampler(image, Layer(l));
+			const uint8_t *data = noise_sampler.getData();
+			size_t stride = noise_sampler.getStride();
+			for(uint32_t y = 0; y < height; y++) {
+				const float32_t *row = (const float32_t*)(data + stride * y);
+				for(uint32_t x = 0; x < width; x++) {
+					uint32_t rank = (uint32_t)(row[x] * (num_pixels - 1) + 0.5f);
+					if(compact) ranks_16[width * y + x] = (uint16_t)rank;
+					else ranks_32[width * y + x] = rank;
+				}
+			}
+			if(compact) status &= (file.write(ranks_16.get(), sizeof(uint16_t) * num_pixels) == sizeof(uint16_t) * num_pixels);
+			else status &= (file.write(ranks_32.get(), sizeof(uint32_t) * num_pixels) == sizeof(uint32_t) * num_pixels);
+		}
+		file.close();
+		
+		// rename cache file
+		if(status && File::isFile(name.get())) File::remove(name.get());
+		if(!status || !File::rename(temp_name.get(), name.get())) {
+			TS_LOGF(Error, "BlueNoiseCache::save(): can't write cache file \"%s\"\n", name.get());
+			File::remove(temp_name.get());
+			return false;
+		}
+		
+		return true;
+	}
+}
@@ -0,0 +1,70 @@
+// MIT License
+// 
+// Copyright (C) 2018-2023, Tellusim Technologies Inc. https://tellusim.com/
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef __NOISE_BLUE_NOISE_CACHE_H__
+#define __NOISE_BLUE_NOISE_CACHE_H__
+
+#include <format/TellusimImage.h>
+
+/*
+ */
+namespace Tellusim {
+	
+	/*
+	 */
+	class BlueNoiseCache {
+			
+		public:
+			
+			BlueNoiseCache();
+			~BlueNoiseCache();
+			
+			/// create result cache in the directory
+			bool create(const char *path);
+			
+			/// cache key of the generation parameters and the input image contents
+			static uint64_t getKey(const char *parameters, const Image &image);
+			
+			/// load noise image
+			/// returns the float ranks or an empty image when there is no cached result
+			/// the ranks are quantized to the output bits by the caller, so one entry serves all output formats
+			Image load(uint64_t key) const;
+			
+			/// save noise image ranks
+			/// the image must contain the float ranks, which are stored as exact integer ranks
+			bool save(uint64_t key, const Image &image) const;
+			
+		private:
+			
+			/// cache file name
+			String get_name(uint64_t key) const;
+			
+			enum {
+				Magic	= 0x4e425354,	// TSBN
+				Version	= 3,
+			};
+			
+			String path;					// cache directory
+	};
+}
+
+#endif /* __NOISE_BLUE_NOISE_CACHE_H__ */
@@ -0,0 +1,266 @@
+// MIT License
+// 
+// Copyright (C) 2018-2023, Tellusim Technologies Inc. https://tellusim.com/
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <core/TellusimLog.h>
+
+#include "BlueNoiseQueue.h"
+
+/*
+ */
+namespace Tellusim {
+	
+	/*
+	 */
+	class BlueNoiseQueue::Request : public Thread {
+			
+		public:
+			
+			Request(BlueNoiseQueue *queue, uint32_t id, const Array<Image> &images, const Parameters &parameters) : queue(queue), id(id), images(images), parameters(parameters) {
+				state.set(StateQueued);
+				canceled.set(0);
+			}
+			
+			/// request progress
+			BlueNoise::Progress getProgress() {
+				ScopedMutex scoped_mutex(mutex);
+				return progress;
+			}
+			
+			BlueNoiseQueue *queue = nullptr;	// request queue
+			uint32_t id = 0;				// request identifier
+			Array<Image> images;			// input images
+			Parameters parameters;			// request parameters
+			Array<Image> noise_images;		// noise images
+			
+			Atomic<uint32_t> state;			// request state
+			Atomic<uint32_t> canceled;		// cancel request
+			
+		private:
+			
+			/// generate the request noise
+			virtual void process() {
+				
+				// the generator resources are released with the device token
+				// the queue device is used only by the token owner
+				queue->acquire_device();
+				{
+					const Device &device = queue->device;
+					uint32_t width = images[0].getWidth();
+					uint32_t height = images[0].getHeight();
+					
+					// create blue noise
+					BlueNoise blue_noise;
+					blue_noise.setTileSize(parameters.tile);
+					if(canceled.get() || !blue_noise.create(device, width, height, parameters.layers, parameters.flags, parameters.batch)) {
+						if(!canceled.get()) TS_LOGF(Error, "BlueNoiseQueue::Request::process(): can't create BlueNoise for request %u\n", id);
+						state.set((canceled.get()) ? StateCanceled : StateFailed);
+						queue->release_device();
+						return;
+					}
+					if(parameters.flags & BlueNoise::FlagIncremental) {
+						blue_noise.setEnergySync(parameters.sync);
+						blue_noise.setEnergyRadius(parameters.radius);
+					}
+					blue_noise.setSelection(parameters.select, parameters.distance);
+					blue_noise.setOutputBits(parameters.bits);
+					
+					// request progress
+					blue_noise.setProgressCallback([this](const BlueNoise::Progress &p) {
+						ScopedMutex scoped_mutex(mutex);
+						progress = p;
+					}, 0.25f);
+					
+					// the device is passed to the next request after every batch
+					blue_noise.setBatchCallback([this]() -> bool {
+						queue->yield_device();
+						return !canceled.get();
+					});
+					
+					// dispatch blue noise
+					state.set(StateRunning);
+					noise_images = blue_noise.dispatch(device, images, parameters.layers, parameters.sigma, parameters.epsilon);
+				}
+				queue->release_device();
+				
+				// request state
+				if(canceled.get()) state.set(StateCanceled);
+				else state.set((noise_images) ? StateDone : StateFailed);
+			}
+			
+			Mutex mutex;					// progress mutex
+			BlueNoise::Progress progress;	// request progress
+	};
+	
+	/*
+	 */
+	BlueNoiseQueue::BlueNoiseQueue() {
+		next_ticket.set(0);
+		serving_ticket.set(0);
+	}
+	
+	BlueNoiseQueue::~BlueNoiseQueue() {
+		
+		// the unfinished requests are canceled
+		for(Request *request : requests) {
+			request->canceled.set(1);
+		}
+		for(Request *request : requests) {
+			request->stop();
+			delete request;
+		}
+	}
+	
+	/*
+	 */
+	bool BlueNoiseQueue::create(PlatformType platform, uint32_t index) {
+		
+		// create context
+		// the context is shared by all requests
+		context = Context(platform, index);
+		if(!context || !context.create()) {
+			TS_LOGF(Error, "BlueNoiseQueue::create(): can't create context %u\n", index);
+			context = Context();
+			return false;
+		}
+		
+		// create device
+		device = Device(context);
+		if(!device.hasShader(Shader::TypeCompute)) {
+			TS_LOG(Error, "BlueNoiseQueue::create(): compute shader is not supported\n");
+			device = Device();
+			context = Context();
+			return false;
+		}
+		
+		return true;
+	}
+	
+	/*
+	 */
+	uint32_t BlueNoiseQueue::submit(const Array<Image> &images, const Parameters &parameters) {
+		
+		// check request
+		if(!device) {
+			TS_LOG(Error, "BlueNoiseQueue::submit(): queue is not created\n");
+			return 0;
+		}
+		if(!images) {
+			TS_LOG(Error, "BlueNoiseQueue::submit(): no images\n");
+			return 0;
+		}
+		
+		// run request thread
+		// the request waits for the device token in its thread
+		Request *request = new Request(this, ++request_id, images, parameters);
+		if(!request->run()) {
+			TS_LOGF(Error, "BlueNoiseQueue::submit(): can't run request %u\n", request->id);
+			delete request;
+			return 0;
+		}
+		requests.append(request);
+		
+		return request->id;
+	}
+	
+	/*
+	 */
+	BlueNoiseQueue::State BlueNoiseQueue::getState(uint32_t id) const {
+		const Request *request = find_request(id);
+		return (request) ? (State)request->state.get() : StateUnknown;
+	}
+	
+	bool BlueNoiseQueue::isDone(uint32_t id) const {
+		State state = getState(id);
+		return (state == StateDone || state == StateFailed || state == StateCanceled);
+	}
+	
+	BlueNoise::Progress BlueNoiseQueue::getProgress(uint32_t id) const {
+		Request *request = find_request(id);
+		return (request) ? request->getProgress() : BlueNoise::Progress();
+	}
+	
+	void BlueNoiseQueue::cancel(uint32_t id) {
+		Request *request = find_request(id);
+		if(request) request->canceled.set(1);
+	}
+	
+	/*
+	 */
+	Array<Image> BlueNoiseQueue::wait(uint32_t id) {
+		
+		// find request
+		uint32_t index = Maxu32;
+		for(uint32_t i = 0; i < requests.size(); i++) {
+			if(requests[i]->id == id) index = i;
+		}
+		if(index == Maxu32) {
+			TS_LOGF(Error, "BlueNoiseQueue::wait(): unknown request %u\n", id);
+			return Array<Image>();
+		}
+		
+		// join the request thread
+		Request *request = requests[index];
+		request->stop();
+		
+		// release request
+		Array<Image> noise_images;
+		if(request->state.get() == StateDone) noise_images = request->noise_images;
+		requests.remove(index);
+		delete request;
+		
+		return noise_images;
+	}
+	
+	/*
+	 */
+	BlueNoiseQueue::Request *BlueNoiseQueue::find_request(uint32_t id) const {
+		for(Request *request : requests) {
+			if(request->id == id) return request;
+		}
+		return nullptr;
+	}
+	
+	/*
+	 */
+	void BlueNoiseQueue::acquire_device() {
+		
+		// the token owner keeps the device mutex locked, so the waiting requests are blocked by the mutex
+		// a request woken out of its turn passes the mutex to the ticket owner
+		uint32_t ticket = next_ticket.fetchAdd(1);
+		while(true) {
+			device_mutex.lock();
+			if(serving_ticket.get() == ticket) break;
+			device_mutex.unlock();
+		}
+	}
+	
+	void BlueNoiseQueue::release_device() {
+		serving_ticket.fetchAdd(1);
+		device_mutex.unlock();
+	}
+	
+	void BlueNoiseQueue::yield_device() {
+		release_device();
+		acquire_device();
+	}
+}
@@ -0,0 +1,121 @@
+// MIT License
+// 
+// Copyright (C) 2018-2023, Tellusim Technologies Inc. https://tellusim.com/
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#ifndef __NOISE_BLUE_NOISE_QUEUE_H__
+#define __NOISE_BLUE_NOISE_QUEUE_H__
+
+#include <core/TellusimThread.h>
+
+#include "BlueNoise.h"
+
+/*
+ */
+namespace Tellusim {
+	
+	/*
+	 */
+	class BlueNoiseQueue {
+			
+		public:
+			
+			/// request states
+			enum State {
+				StateUnknown = 0,				// unknown request
+				StateQueued,					// waiting for the device
+				StateRunning,					// generating noise
+				StateDone,						// noise is ready
+				StateFailed,					// generation failed
+				StateCanceled,					// request is canceled
+			};
+			
+			/// request parameters
+			struct Parameters {
+				uint32_t layers = 1;			// noise layers
+				float32_t sigma = 2.0f;			// Gaussian sigma
+				float32_t epsilon = 0.01f;		// quadratic epsilon
+				BlueNoise::Flags flags = BlueNoise::DefaultFlags;	// generator flags
+				float32_t batch = 4.0f;			// target batch time in milliseconds
+				uint32_t sync = 32;				// incremental energy sync iterations
+				float32_t radius = 4.0f;		// incremental energy radius
+				uint32_t select = 1;			// selection count
+				float32_t distance = 3.0f;		// selection distance
+				uint32_t tile = 0;				// tile size
+				uint32_t bits = 32;				// output bits
+			};
+			
+			BlueNoiseQueue();
+			~BlueNoiseQueue();
+			
+			/// create request queue
+			/// the queue owns the context and the device, and the batches of all requests are interleaved on it in the submission order
+			bool create(PlatformType platform, uint32_t index);
+			
+			/// submit request
+			/// the request is generated by its own thread on the queue device, the call returns the request identifier or zero on failure
+			/// the queue methods must be called by the same thread
+			uint32_t submit(const Array<Image> &images, const Parameters &parameters);
+			
+			/// request state
+			State getState(uint32_t id) const;
+			bool isDone(uint32_t id) const;
+			
+			/// request progress
+			/// the progress is updated by the request thread during the generation
+			BlueNoise::Progress getProgress(uint32_t id) const;
+			
+			/// cancel request
+			/// the request stops after the current batch
+			void cancel(uint32_t id);
+			
+			/// wait for the request and release it
+			/// the calling thread is blocked until the request thread is finished
+			/// returns the noise images or an empty array when the request is failed or canceled
+			Array<Image> wait(uint32_t id);
+			
+		private:
+			
+			class Request;
+			
+			/// find request
+			Request *find_request(uint32_t id) const;
+			
+			/// device token
+			/// the tickets are served in the order of requests, so every yield passes the device to the next waiting request
+			/// only the token owner records commands on the device
+			void acquire_device();
+			void release_device();
+			void yield_device();
+			
+			Context context;				// queue context
+			Device device;					// queue device
+			
+			Array<Request*> requests;		// active requests
+			uint32_t request_id = 0;		// last request identifier
+			
+			Mutex device_mutex;				// device token mutex
+			Atomic<uint32_t> next_ticket;	// next device ticket
+			Atomic<uint32_t> serving_ticket;	// serving device ticket
+	};
+}
+
+#endif /* __NOISE_BLUE_NOISE_QUEUE_H__ */
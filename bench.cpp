@@ -0,0 +1,198 @@
+// MIT License
+// 
+// Copyright (C) 2018-2023, Tellusim Technologies Inc. https://tellusim.com/
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <TellusimApp.h>
+#include <core/TellusimLog.h>
+#include <core/TellusimTime.h>
+#include <core/TellusimFile.h>
+#include <math/TellusimRandom.h>
+#include <format/TellusimImage.h>
+#include <platform/TellusimPlatforms.h>
+
+#include "BlueNoise.h"
+
+/*
+ */
+int32_t main(int32_t argc, char **argv) {
+	
+	using namespace Tellusim;
+	
+	// initialize application
+	App app(argc, argv);
+	
+	// print help
+	if(argc > 1 && String(argv[1]) == "-h") {
+		Log::printf("Tellusim Blue Noise Benchmark (build " __DATE__ " https://tellusim.com/)\nUsage: %s -o bench.json\n", argv[0]);
+		Log::print("  -o <filename>     JSON output (bench.json)\n");
+		Log::print("  -min <size>       Minimal image size (64)\n");
+		Log::print("  -max <size>       Maximal image size (2048)\n");
+		Log::print("  -layers <layers>  Image layers, can be repeated (1 and 4)\n");
+		Log::print("  -batch <ms>       Adaptive batch time, can be repeated (0 and 4)\n");
+		Log::print("  -sync <value>     Incremental energy sync iterations (0)\n");
+		Log::print("  -select <count>   Positions per energy update (1)\n");
+		Log::print("  -precision <bits> Energy precision 16 or 32 (32)\n");
+		Log::print("  -seed <value>     Random seed (1)\n");
+		return 0;
+	}
+	
+	// parameters
+	String output_name = "bench.json";
+	uint32_t min_size = 64;
+	uint32_t max_size = 2048;
+	Array<uint32_t> layer_counts;
+	Array<float32_t> batch_times;
+	uint32_t sync = 0;
+	uint32_t select = 1;
+	uint32_t precision = 32;
+	uint32_t seed = 1;
+	
+	// command line arguments
+	for(int32_t i = 1; i < argc; i++) {
+		const char *s = argv[i];
+		
+		// commands
+		if(s[0] == '-') {
+			while(*s == '-') s++;
+			String command = String(s);
+			
+			if(command == "o" && i + 1 < argc) output_name = argv[++i];
+			else if(command == "min" && i + 1 < argc) min_size = String::tou32(argv[++i]);
+			else if(command == "max" && i + 1 < argc) max_size = String::tou32(argv[++i]);
+			else if(command == "layers" && i + 1 < argc) layer_counts.append(max(String::tou32(argv[++i]), 1u));
+			else if(command == "batch" && i + 1 < argc) batch_times.append(String::tof32(argv[++i]));
+			else if(command == "sync" && i + 1 < argc) sync = String::tou32(argv[++i]);
+			else if(command == "select" && i + 1 < argc) select = String::tou32(argv[++i]);
+			else if(command == "precision" && i + 1 < argc) precision = String::tou32(argv[++i]);
+			else if(command == "seed" && i + 1 < argc) seed = String::tou32(argv[++i]);
+		}
+		// unknown command
+		else {
+			TS_LOGF(Error, "%s: invalid command line option \"%s\"\n", argv[0], argv[i]);
+			return 1;
+		}
+	}
+	if(!layer_counts) layer_counts = { 1, 4 };
+	if(!batch_times) batch_times = { 0.0f, 4.0f };
+	
+	// create context
+	Context context(app.getPlatform(), app.getDevice());
+	if(!context || !context.create()) {
+		TS_LOGF(Error, "%s: can't create context\n", argv[0]);
+		return 1;
+	}
+	
+	// create device
+	Device device(context);
+	if(!device.hasShader(Shader::TypeCompute)) {
+		TS_LOGF(Error, "%s: compute shader is not supported\n", argv[0]);
+		return 1;
+	}
+	Log::printf("Platform: %s Device: %s\n", device.getPlatformName(), device.getName().get());
+	
+	// blue noise flags
+	uint32_t flags = BlueNoise::DefaultFlags;
+	if(sync) flags |= BlueNoise::FlagIncremental;
+	if(precision == 16) flags |= BlueNoise::FlagHalf;
+	else if(precision != 32) {
+		TS_LOGF(Error, "%s: invalid energy precision %u\n", argv[0], precision);
+		return 1;
+	}
+	
+	// benchmark results
+	String results = String::format("{\n\t\"platform\": \"%s\",\n\t\"device\": \"%s\",\n", device.getPlatformName(), device.getName().get());
+	results += String::format("\t\"sync\": %u,\n\t\"select\": %u,\n\t\"precision\": %u,\n\t\"results\": [", sync, select, precision);
+	bool first_result = true;
+	
+	// sweep parameters
+	for(uint32_t size = npot(max(min_size, 1u)); size <= max_size; size *= 2) {
+		for(uint32_t layers : layer_counts) {
+			for(float32_t batch : batch_times) {
+				
+				// create blue noise
+				BlueNoise blue_noise;
+				if(!blue_noise.create(device, size, size, layers, (BlueNoise::Flags)flags, batch)) {
+					TS_LOGF(Error, "%s: can't create BlueNoise\n", argv[0]);
+					return 1;
+				}
+				if(sync) blue_noise.setEnergySync(sync);
+				blue_noise.setSelection(select, 3.0f);
+				blue_noise.setStatistics(true);
+				
+				// create input image
+				// the same seed gives the same initial positions for every configuration
+				Image input_image;
+				Random<int32_t> random(seed);
+				input_image.create2D(FormatRu8n, size, size);
+				uint8_t *input_data = input_image.getData();
+				size_t input_stride = input_image.getStride();
+				for(uint32_t y = 0; y < size / 10; y++) {
+					for(uint32_t x = 0; x < size; x++) {
+						uint32_t X = random.geti32(0, size - 1);
+						uint32_t Y = random.geti32(0, size - 1);
+						input_data[input_stride * Y + X] = 255;
+					}
+				}
+				
+				// dispatch blue noise
+				Log::printf("Size: %ux%u Layers: %u Batch: %g\n", size, size, layers, batch);
+				uint64_t begin = Time::current();
+				Image noise_image = blue_noise.dispatch(device, input_image, layers, 2.0f, 0.01f);
+				float64_t time = (float64_t)(Time::current() - begin) / Time::Seconds;
+				if(!noise_image) {
+					TS_LOGF(Error, "%s: can't create noise\n", argv[0]);
+					return 1;
+				}
+				
+				// phase results
+				uint64_t iterations = 0;
+				String phases;
+				for(uint32_t i = 0; i < BlueNoise::NumPhases; i++) {
+					BlueNoise::Phase phase = (BlueNoise::Phase)i;
+					const BlueNoise::Statistics &statistics = blue_noise.getStatistics(phase);
+					float64_t phase_time = (float64_t)statistics.time / Time::Seconds;
+					float64_t rate = (phase_time > 0.0) ? statistics.iterations / phase_time : 0.0;
+					float64_t kernel_time = (statistics.kernels) ? 1000.0 * phase_time / statistics.kernels : 0.0;
+					if(phase != BlueNoise::PhaseRender) iterations += statistics.iterations;
+					phases += String::format("%s\n\t\t\t\t\"%s\": { \"time\": %.6f, \"iterations\": %llu, \"kernels\": %llu, \"iterations_per_second\": %.1f, \"ms_per_kernel\": %.6f }", (i) ? "," : "", BlueNoise::getPhaseName(phase), phase_time, (unsigned long long)statistics.iterations, (unsigned long long)statistics.kernels, rate, kernel_time);
+					Log::printf("  %-8s %8.3f s %10.1f it/s %8.4f ms/kernel\n", BlueNoise::getPhaseName(phase), phase_time, rate, kernel_time);
+				}
+				
+				// configuration result
+				results += String::format("%s\n\t\t{\n\t\t\t\"width\": %u,\n\t\t\t\"height\": %u,\n\t\t\t\"layers\": %u,\n\t\t\t\"batch\": %g,\n", (first_result) ? "" : ",", size, size, layers, batch);
+				results += String::format("\t\t\t\"time\": %.6f,\n\t\t\t\"iterations_per_second\": %.1f,\n\t\t\t\"phases\": {%s\n\t\t\t}\n\t\t}", time, (time > 0.0) ? iterations / time : 0.0, phases.get());
+				first_result = false;
+			}
+		}
+	}
+	results += "\n\t]\n}\n";
+	
+	// save results
+	File file;
+	if(!file.open(output_name.get(), "wb") || !file.puts(results.get())) {
+		TS_LOGF(Error, "%s: can't save \"%s\" results\n", argv[0], output_name.get());
+		return 1;
+	}
+	file.close();
+	Log::printf("Results: %s\n", output_name.get());
+	
+	return 0;
+}
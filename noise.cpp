@@ -24,17 +24,102 @@
 #include <core/TellusimLog.h>
 #include <core/TellusimTime.h>
 #include <core/TellusimFile.h>
+#include <core/TellusimMemory.h>
 #include <core/TellusimDirectory.h>
+#include <core/TellusimThread.h>
 #include <math/TellusimRandom.h>
 #include <format/TellusimImage.h>
 #include <platform/TellusimPlatforms.h>
 
 #include "BlueNoise.h"
+#include "BlueNoiseCPU.h"
+#include "BlueNoiseCache.h"
 
 /*
  */
 #define CACHE_PATH		".tellusim/"
 #define CACHE_NAME		"noise_shader.cache"
+#define CACHE_RESULTS	"noise_results"
+
+/*
+ */
+namespace Tellusim {
+	
+	/*
+	 */
+	class NoiseWorker : public Thread {
+			
+		public:
+			
+			/// generate the worker images on its own device
+			virtual void process() {
+				
+				// create context
+				Context context(platform, index);
+				if(!context || !context.create()) {
+					TS_LOGF(Error, "NoiseWorker::process(): can't create context %u\n", index);
+					return;
+				}
+				
+				// create device
+				Device device(context);
+				if(!device.hasShader(Shader::TypeCompute)) {
+					TS_LOGF(Error, "NoiseWorker::process(): compute shader is not supported on device %u\n", index);
+					return;
+				}
+				Log::printf("Worker: %u Device: %s Images: %u\n", index, device.getName().get(), input_images.size());
+				
+				// create blue noise
+				BlueNoise blue_noise;
+				blue_noise.setTileSize(tile);
+				if(!blue_noise.create(device, width, height, layers, (BlueNoise::Flags)flags, batch)) {
+					TS_LOGF(Error, "NoiseWorker::process(): can't create BlueNoise on device %u\n", index);
+					return;
+				}
+				if(flags & BlueNoise::FlagIncremental) {
+					blue_noise.setEnergySync(sync);
+					blue_noise.setEnergyRadius(radius);
+				}
+				blue_noise.setSelection(select, distance);
+				blue_noise.setOutputBits(bits);
+				if(layer_callback) blue_noise.setLayerCallback(layer_callback);
+				if(progress_callback) blue_noise.setProgressCallback(progress_callback);
+				
+				// generation checkpoint
+				if(checkpoint_name) {
+					blue_noise.setCheckpoint(checkpoint_name.get(), checkpoint);
+					if(resume) blue_noise.loadCheckpoint(checkpoint_name.get());
+				}
+				
+				// dispatch blue noise
+				noise_images = blue_noise.dispatch(device, input_images, layers, sigma, epsilon);
+			}
+			
+			PlatformType platform = PlatformUnknown;	// context platform
+			uint32_t index = 0;				// device index
+			uint32_t width = 0;				// image width
+			uint32_t height = 0;			// image height
+			uint32_t layers = 0;			// image layers
+			uint32_t flags = 0;				// generator flags
+			float32_t batch = 0.0f;			// batch time
+			uint32_t sync = 0;				// energy sync
+			float32_t radius = 0.0f;		// energy radius
+			uint32_t select = 1;			// selection count
+			float32_t distance = 0.0f;		// selection distance
+			uint32_t tile = 0;				// tile size
+			float32_t sigma = 0.0f;			// Gaussian sigma
+			float32_t epsilon = 0.0f;		// quadratic epsilon
+			String checkpoint_name;			// checkpoint name
+			float32_t checkpoint = 0.0f;	// checkpoint interval
+			bool resume = false;			// resume flag
+			uint32_t bits = 32;				// output bits
+			BlueNoise::LayerCallback layer_callback;	// layer sink callback
+			BlueNoise::ProgressCallback progress_callback;	// progress callback
+			
+			Array<Image> input_images;		// worker input images
+			Array<Image> noise_images;		// worker noise images
+	};
+}
 
 /*
  */
@@ -54,16 +139,37 @@ int32_t main(int32_t argc, char **argv) {
 		Log::print("  -ox <filename>    Forward X image\n");
 		Log::print("  -oy <filename>    Forward Y image\n");
 		Log::print("  -oh <filename>    Histogram output\n");
+		Log::print("  -log              Logarithmic forward image magnitude\n");
 		Log::print("  -bits <bits>      Image bits (8)\n");
 		Log::print("  -size <size>      Image size (128)\n");
 		Log::print("  -width <width>    Image width (128)\n");
 		Log::print("  -height <height>  Image width (128)\n");
 		Log::print("  -layers <layers>  Image layers (1)\n");
+		Log::print("  -volume           Volume noise with all layers generated together\n");
+		Log::print("  -tile <size>      Tiled generation window size for large images (0)\n");
 		Log::print("  -seed <value>     Random seed (random)\n");
+		Log::print("  -count <count>    Number of images with consecutive seeds (1)\n");
+		Log::print("  -channels <count> Separately generated images merged into RGBA (1)\n");
 		Log::print("  -init <value>     Initial pixels (10%)\n");
 		Log::print("  -sigma <value>    Gaussian sigma (2.0)\n");
 		Log::print("  -epsilon <value>  Quadratic epsilon (0.01)\n");
+		Log::print("  -sync <value>     Incremental energy sync iterations (0)\n");
+		Log::print("  -radius <value>   Incremental energy radius in sigmas (4.0)\n");
+		Log::print("  -select <count>   Positions per energy update (1)\n");
+		Log::print("  -distance <value> Selection distance in sigmas (3.0)\n");
+		Log::print("  -batch <ms>       Adaptive batch time in milliseconds (0)\n");
+		Log::print("  -precision <bits> Energy precision 16 or 32 (32)\n");
+		Log::print("  -check            Compare half precision with full precision\n");
+		Log::print("  -cpu              CPU generator without compute device\n");
+		Log::print("  -threads <count>  CPU generator threads (all)\n");
+		Log::print("  -nocache          Disable the generated noise cache\n");
+		Log::print("  -checkpoint <min> Checkpoint interval in minutes (0)\n");
+		Log::print("  -resume           Resume from the last checkpoint\n");
+		Log::print("  -stream           Save every layer into a separate image as it's generated\n");
+		Log::print("  -profile          Print the GPU stage profile\n");
+		Log::print("  -progress <mode>  Progress output log or json lines (log)\n");
 		Log::print("  -device <index>   Computation device index\n");
+		Log::print("  -devices <count>  Number of devices for multiple images (1)\n");
 		return 0;
 	}
 	
@@ -74,14 +180,35 @@ int32_t main(int32_t argc, char **argv) {
 	String forward_x_name;
 	String forward_y_name;
 	String histogram_name;
+	bool log_forward = false;
 	uint32_t init = 10;
 	uint32_t bits = 8;
 	uint32_t width = 128;
 	uint32_t height = 128;
 	uint32_t layers = 1;
+	bool volume = false;
+	uint32_t tile = 0;
 	uint32_t seed = (uint32_t)Time::current();
+	uint32_t count = 1;
+	uint32_t channels = 1;
+	uint32_t devices = 1;
 	float32_t sigma = 2.0f;
 	float32_t epsilon = 0.01f;
+	uint32_t sync = 0;
+	float32_t radius = 4.0f;
+	uint32_t select = 1;
+	float32_t distance = 3.0f;
+	float32_t batch = 0.0f;
+	uint32_t precision = 32;
+	bool check = false;
+	bool cpu = false;
+	uint32_t threads = 0;
+	bool cache = true;
+	float32_t checkpoint = 0.0f;
+	bool resume = false;
+	bool stream = false;
+	bool profile = false;
+	String progress_mode = "log";
 	
 	// command line arguments
 	for(int32_t i = 1; i < argc; i++) {
@@ -98,15 +225,36 @@ int32_t main(int32_t argc, char **argv) {
 			else if(command == "ox" && i + 1 < argc) forward_x_name = argv[++i];
 			else if(command == "oy" && i + 1 < argc) forward_y_name = argv[++i];
 			else if(command == "oh" && i + 1 < argc) histogram_name = argv[++i];
+			else if(command == "log") log_forward = true;
 			else if((command == "bits" || command == "b") && i + 1 < argc) bits = String::tou32(argv[++i]);
 			else if((command == "size" || command == "s") && i + 1 < argc) width = height = String::tou32(argv[++i]);
 			else if((command == "width" || command == "w") && i + 1 < argc) width = String::tou32(argv[++i]);
 			else if((command == "height" || command == "h") && i + 1 < argc) height = String::tou32(argv[++i]);
 			else if((command == "layers" || command == "l") && i + 1 < argc) layers = String::tou32(argv[++i]);
 			else if((command == "seed" || command == "r") && i + 1 < argc) seed = String::tou32(argv[++i]);
+			else if(command == "count" && i + 1 < argc) count = max(String::tou32(argv[++i]), 1u);
+			else if(command == "tile" && i + 1 < argc) tile = String::tou32(argv[++i]);
+			else if(command == "channels" && i + 1 < argc) channels = String::tou32(argv[++i]);
 			else if((command == "init" || command == "p") && i + 1 < argc) init = String::tou32(argv[++i]);
 			else if((command == "sigma" || command == "si") && i + 1 < argc) sigma = String::tof32(argv[++i]);
 			else if((command == "epsilon" || command == "e") && i + 1 < argc) epsilon = String::tof32(argv[++i]);
+			else if(command == "sync" && i + 1 < argc) sync = String::tou32(argv[++i]);
+			else if(command == "radius" && i + 1 < argc) radius = String::tof32(argv[++i]);
+			else if(command == "select" && i + 1 < argc) select = String::tou32(argv[++i]);
+			else if(command == "distance" && i + 1 < argc) distance = String::tof32(argv[++i]);
+			else if(command == "batch" && i + 1 < argc) batch = String::tof32(argv[++i]);
+			else if(command == "precision" && i + 1 < argc) precision = String::tou32(argv[++i]);
+			else if(command == "devices" && i + 1 < argc) devices = max(String::tou32(argv[++i]), 1u);
+			else if(command == "volume") volume = true;
+			else if(command == "check") check = true;
+			else if(command == "cpu") cpu = true;
+			else if(command == "nocache") cache = false;
+			else if(command == "checkpoint" && i + 1 < argc) checkpoint = String::tof32(argv[++i]);
+			else if(command == "resume") resume = true;
+			else if(command == "stream") stream = true;
+			else if(command == "profile") profile = true;
+			else if(command == "progress" && i + 1 < argc) progress_mode = argv[++i];
+			else if(command == "threads" && i + 1 < argc) threads = String::tou32(argv[++i]);
 		}
 		// unknown command
 		else {
@@ -127,109 +275,520 @@ int32_t main(int32_t argc, char **argv) {
 	}
 	
 	// create context
+	// the CPU generator is used when there is no compute device
 	Context context(app.getPlatform(), app.getDevice());
-	if(!context || !context.create()) {
-		TS_LOGF(Error, "%s: can't create context\n", argv[0]);
-		return 1;
+	if(!cpu && (!context || !context.create())) {
+		TS_LOGF(Warning, "%s: can't create context, using CPU generator\n", argv[0]);
+		cpu = true;
 	}
 	
 	// create device
-	Device device(context);
-	
-	// check compute shader support
-	if(!device.hasShader(Shader::TypeCompute)) {
-		TS_LOGF(Error, "%s: compute shader is not supported\n", argv[0]);
-		return 1;
+	Device device;
+	if(!cpu) {
+		device = Device(context);
+		
+		// check compute shader support
+		if(!device.hasShader(Shader::TypeCompute)) {
+			TS_LOGF(Warning, "%s: compute shader is not supported, using CPU generator\n", argv[0]);
+			cpu = true;
+		} else {
+			Log::printf("Platform: %s Device: %s\n", device.getPlatformName(), device.getName().get());
+		}
 	}
-	Log::printf("Platform: %s Device: %s\n", device.getPlatformName(), device.getName().get());
 	
 	// noise shader cache
 	String path = Directory::getHomeDirectory() + "/" + CACHE_PATH;
-	if(Directory::isDirectory(path) || Directory::createDirectory(path)) {
+	if((Directory::isDirectory(path) || Directory::createDirectory(path)) && !cpu) {
 		String name = Directory::getHomeDirectory() + "/" + CACHE_PATH + CACHE_NAME;
 		Shader::setCache(name.get());
 	}
 	
+	// check CPU options
+	if(cpu && (precision != 32 || check || devices > 1 || profile || volume || tile)) {
+		TS_LOGF(Warning, "%s: precision, check, devices, profile, volume and tile options are ignored by CPU generator\n", argv[0]);
+		precision = 32;
+		check = false;
+		devices = 1;
+		profile = false;
+		volume = false;
+		tile = 0;
+	}
+	
+	// check progress mode
+	if(progress_mode != "log" && progress_mode != "json") {
+		TS_LOGF(Error, "%s: invalid progress mode \"%s\"\n", argv[0], progress_mode.get());
+		return 1;
+	}
+	
+	// check channels
+	// every channel is seeded separately, so the input image provides a single channel
+	if(channels < 1 || channels > 4) {
+		TS_LOGF(Error, "%s: invalid number of channels %u\n", argv[0], channels);
+		return 1;
+	}
+	if(channels > 1 && input_image) {
+		TS_LOGF(Warning, "%s: channels option is ignored with input image\n", argv[0]);
+		channels = 1;
+	}
+	
+	// check image bits
+	if(bits != 8 && bits != 16 && bits != 32) {
+		TS_LOGF(Error, "%s: invalid image bits %u\n", argv[0], bits);
+		return 1;
+	}
+	
+	// check streaming options
+	// the streamed layers are never kept together, so the whole image outputs and the result cache are not available
+	if(stream && !output_name) {
+		TS_LOGF(Error, "%s: streaming requires output image\n", argv[0]);
+		return 1;
+	}
+	if(stream && (forward_name || forward_x_name || forward_y_name || histogram_name || check)) {
+		TS_LOGF(Warning, "%s: forward, histogram and check options are ignored in streaming mode\n", argv[0]);
+		forward_name = String();
+		forward_x_name = String();
+		forward_y_name = String();
+		histogram_name = String();
+		check = false;
+	}
+	if(stream) cache = false;
+	
+	// check quality options
+	// the half precision check compares against a full precision reference
+	if(check && precision != 16) {
+		TS_LOGF(Warning, "%s: check option requires 16-bit precision\n", argv[0]);
+		check = false;
+	}
+	
+	// blue noise flags
+	uint32_t flags = BlueNoise::DefaultFlags;
+	if(sync) flags |= BlueNoise::FlagIncremental;
+	if(volume) flags |= BlueNoise::FlagVolume;
+	if(precision == 16) flags |= BlueNoise::FlagHalf;
+	else if(precision != 32) {
+		TS_LOGF(Error, "%s: invalid energy precision %u\n", argv[0], precision);
+		return 1;
+	}
+	
 	// create blue noise
 	BlueNoise blue_noise;
-	if(!blue_noise.create(device, width, height, layers)) {
-		TS_LOGF(Error, "%s: can't create BlueNoise\n", argv[0]);
-		return 1;
+	BlueNoiseCPU cpu_noise;
+	if(cpu) {
+		if(!cpu_noise.create(width, height, layers, threads)) {
+			TS_LOGF(Error, "%s: can't create BlueNoiseCPU\n", argv[0]);
+			return 1;
+		}
+		if(sync) cpu_noise.setEnergyRadius(radius);
+		Log::printf("Platform: CPU\n");
+	} else {
+		blue_noise.setTileSize(tile);
+		if(!blue_noise.create(device, width, height, layers, (BlueNoise::Flags)flags, batch)) {
+			TS_LOGF(Error, "%s: can't create BlueNoise\n", argv[0]);
+			return 1;
+		}
+		if(sync) {
+			blue_noise.setEnergySync(sync);
+			blue_noise.setEnergyRadius(radius);
+		}
+		blue_noise.setSelection(select, distance);
+		blue_noise.setProfile(profile);
 	}
 	
-	// create image
+	// forward transform
+	auto dispatch_forward = [&](const Image &image) -> Image {
+		if(cpu) return cpu_noise.dispatchForward(image);
+		return blue_noise.dispatchForward(device, image);
+	};
+	
+	// create images
+	// the seeded images share the textures and buffers of one dispatch
+	Array<Image> input_images;
 	if(!input_image) {
-		Random<int32_t> random(seed);
-		input_image.create2D(FormatRu8n, width, height);
-		ImageSampler input_sampler(input_image);
-		for(uint32_t y = 0; y < height * init / 100; y++) {
-			for(uint32_t x = 0; x < width; x++) {
-				uint32_t X = random.geti32(0, width - 1);
-				uint32_t Y = random.geti32(0, height - 1);
-				input_sampler.set2D(X, Y, ImageColor(255u));
+		for(uint32_t i = 0; i < count * channels; i++) {
+			// the volume noise is seeded in every layer
+			Random<int32_t> random(seed + i);
+			uint32_t seed_layers = (volume) ? layers : 1;
+			if(seed_layers > 1) input_image.create2D(FormatRu8n, width, height, seed_layers);
+			else input_image.create2D(FormatRu8n, width, height);
+			for(uint32_t l = 0; l < seed_layers; l++) {
+				ImageSampler input_sampler(input_image, Layer(l));
+				uint8_t *input_data = input_sampler.getData();
+				size_t input_stride = input_sampler.getStride();
+				for(uint32_t y = 0; y < height * init / 100; y++) {
+					for(uint32_t x = 0; x < width; x++) {
+						uint32_t X = random.geti32(0, width - 1);
+						uint32_t Y = random.geti32(0, height - 1);
+						input_data[input_stride * Y + X] = 255;
+					}
+				}
 			}
+			input_images.append(input_image);
+			input_image = Image();
 		}
-		Log::printf("Size: %ux%u Layers: %u Bits: %u Sigma: %g Epsilon: %g Init: %u %% Seed: %u\n", width, height, layers, bits, sigma, epsilon, init, seed);
+		input_image = input_images[0];
+		Log::printf("Size: %ux%u Layers: %u Bits: %u Sigma: %g Epsilon: %g Init: %u %% Seed: %u Count: %u Channels: %u\n", width, height, layers, bits, sigma, epsilon, init, seed, count, channels);
 	} else {
+		input_images.append(input_image);
 		Log::printf("Size: %ux%u Layers: %u Bits: %u Sigma: %g Epsilon: %g\n", width, height, layers, bits, sigma, epsilon);
 	}
 	
+	// result cache
+	// the key covers every parameter that changes the ranks, so cached images skip the generator
+	// the output bits only quantize the cached ranks, and the unused radius and distance don't split the entries
+	BlueNoiseCache noise_cache;
+	if(cache && !noise_cache.create((path + CACHE_RESULTS).get())) cache = false;
+	float32_t key_radius = (sync) ? radius : 0.0f;
+	float32_t key_distance = (select > 1) ? distance : 0.0f;
+	String parameters = String::format("size %ux%u layers %u sigma %g epsilon %g precision %u sync %u radius %g select %u distance %g cpu %u volume %u tile %u", width, height, layers, sigma, epsilon, precision, sync, key_radius, select, key_distance, (uint32_t)cpu, (uint32_t)volume, tile);
+	Array<uint64_t> cache_keys;
+	Array<Image> cache_images;
+	Array<Image> dispatch_images;
+	for(const Image &image : input_images) {
+		uint64_t key = BlueNoiseCache::getKey(parameters.get(), image);
+		Image cache_image = (cache) ? noise_cache.load(key) : Image();
+		if(cache_image && (cache_image.getWidth() != width || cache_image.getHeight() != height || max(cache_image.getLayers(), 1u) != layers)) cache_image = Image();
+		if(!cache_image) dispatch_images.append(image);
+		cache_keys.append(key);
+		cache_images.append(cache_image);
+	}
+	if(cache) Log::printf("Cache: %u of %u images\n", input_images.size() - dispatch_images.size(), input_images.size());
+	
+	// generation checkpoint
+	// the checkpoint name is derived from the keys of the dispatched images, so a resume finds the same run
+	uint64_t dispatch_key = 0xcbf29ce484222325ull;
+	for(uint32_t i = 0; i < input_images.size(); i++) {
+		if(!cache_images[i]) dispatch_key = (dispatch_key ^ cache_keys[i]) * 0x100000001b3ull;
+	}
+	String checkpoint_path = path + CACHE_RESULTS;
+	if((checkpoint > 0.0f || resume) && !Directory::isDirectory(checkpoint_path) && !Directory::createDirectory(checkpoint_path)) {
+		TS_LOGF(Warning, "%s: can't create checkpoint directory\n", argv[0]);
+		checkpoint = 0.0f;
+		resume = false;
+	}
+	if((checkpoint > 0.0f || resume) && cpu) {
+		TS_LOGF(Warning, "%s: checkpoints are not supported by CPU generator\n", argv[0]);
+		checkpoint = 0.0f;
+		resume = false;
+	}
+	auto get_checkpoint_name = [&](uint32_t slot) -> String {
+		return String::format("%s/noise_%08x%08x_%u.checkpoint", checkpoint_path.get(), (uint32_t)(dispatch_key >> 32), (uint32_t)dispatch_key, slot);
+	};
+	
+	// output bits
+	// the ranks are quantized on the device, but the result cache stores the exact ranks, so the cached runs are quantized after the merge
+	uint32_t output_bits = (cache) ? 32 : bits;
+	if(!cpu) blue_noise.setOutputBits(output_bits);
+	
+	// progress output
+	// every progress report is a single JSON line with the device index
+	auto get_progress_callback = [](uint32_t index) -> BlueNoise::ProgressCallback {
+		return [index](const BlueNoise::Progress &progress) {
+			Log::printf("{\"device\": %u, \"phase\": \"%s\", \"layer\": %u, \"layers\": %u, \"iterations\": %llu, \"total\": %llu, \"rate\": %.1f, \"time\": %.3f, \"remain\": %.3f, \"memory\": %llu}\n", index, BlueNoise::getPhaseName(progress.phase), progress.layer, progress.layers, (unsigned long long)progress.iterations, (unsigned long long)progress.total, progress.rate, progress.time, progress.remain, (unsigned long long)progress.memory);
+		};
+	};
+	bool json_progress = (progress_mode == "json" && !cpu);
+	if(json_progress) blue_noise.setProgressCallback(get_progress_callback(app.getDevice()));
+	else if(progress_mode == "json") TS_LOGF(Warning, "%s: json progress is not supported by CPU generator\n", argv[0]);
+	
+	// layer sink
+	// the layers are saved with the image and layer indices before the extension
+	auto save_layer = [&](uint32_t index, uint32_t layer, const Image &image) -> bool {
+		String extension = output_name.extension();
+		String name = output_name.extension(String::format("%u.%s", layer, extension.get()).get());
+		if(input_images.size() > 1) name = output_name.extension(String::format("%u.%u.%s", index, layer, extension.get()).get());
+		if(!image.save(name.get())) {
+			TS_LOGF(Error, "%s: can't save \"%s\" layer image\n", argv[0], name.get());
+			return false;
+		}
+		return true;
+	};
+	
+	// distribute images over devices
+	// the layers of an image are seeded by each other, so every device receives whole images
+	devices = max(min(devices, dispatch_images.size()), 1u);
+	Array<Image> device_images;
+	Array<NoiseWorker*> workers;
+	for(uint32_t i = 1; i < devices; i++) {
+		NoiseWorker *worker = new NoiseWorker();
+		worker->platform = app.getPlatform();
+		worker->index = app.getDevice() + i;
+		worker->width = width;
+		worker->height = height;
+		worker->layers = layers;
+		worker->flags = flags;
+		worker->batch = batch;
+		worker->sync = sync;
+		worker->radius = radius;
+		worker->select = select;
+		worker->distance = distance;
+		worker->tile = tile;
+		worker->sigma = sigma;
+		worker->epsilon = epsilon;
+		if(checkpoint > 0.0f || resume) {
+			worker->checkpoint_name = get_checkpoint_name(i);
+			worker->checkpoint = checkpoint * 60.0f;
+			worker->resume = (resume && File::isFile(worker->checkpoint_name.get()));
+		}
+		worker->bits = output_bits;
+		if(json_progress) worker->progress_callback = get_progress_callback(worker->index);
+		if(stream) {
+			worker->layer_callback = [save_layer, i, devices](uint32_t index, uint32_t layer, const Image &image) -> bool {
+				return save_layer(index * devices + i, layer, image);
+			};
+		}
+		for(uint32_t j = i; j < dispatch_images.size(); j += devices) {
+			worker->input_images.append(dispatch_images[j]);
+		}
+		if(!worker->run()) {
+			TS_LOGF(Error, "%s: can't run worker %u\n", argv[0], i);
+			delete worker;
+			
+			// the started workers reference the local layer sink
+			for(NoiseWorker *started : workers) {
+				started->stop();
+				delete started;
+			}
+			return 1;
+		}
+		workers.append(worker);
+	}
+	for(uint32_t i = 0; i < dispatch_images.size(); i += devices) {
+		device_images.append(dispatch_images[i]);
+	}
+	
+	// streamed layers
+	// the device images are streamed in the worker order
+	if(!cpu && stream) {
+		blue_noise.setLayerCallback([&](uint32_t index, uint32_t layer, const Image &image) -> bool {
+			return save_layer(index * devices, layer, image);
+		});
+	}
+	
+	// generation checkpoint
+	if(!cpu && (checkpoint > 0.0f || resume)) {
+		String checkpoint_name = get_checkpoint_name(0);
+		blue_noise.setCheckpoint(checkpoint_name.get(), checkpoint * 60.0f);
+		if(resume && File::isFile(checkpoint_name.get())) blue_noise.loadCheckpoint(checkpoint_name.get());
+		else if(resume) TS_LOGF(Warning, "%s: there is no checkpoint to resume\n", argv[0]);
+	}
+	
 	// dispatch blue noise
-	Image noise_image = blue_noise.dispatch(device, input_image, layers, sigma, epsilon);
-	if(!noise_image) {
-		TS_LOGF(Error, "%s: can't create noise\n", argv[0]);
-		return 1;
+	bool status = true;
+	if(device_images) {
+		if(cpu) device_images = cpu_noise.dispatch(device_images, layers, sigma, epsilon);
+		else device_images = blue_noise.dispatch(device, device_images, layers, sigma, epsilon);
+		status = (bool)device_images;
 	}
 	
-	// noise image format
-	if(bits == 8) noise_image = noise_image.toFormat(FormatRu8n);
-	else if(bits == 16) noise_image = noise_image.toFormat(FormatRu16n);
-	else if(bits != 32) {
-		TS_LOGF(Error, "%s: invalid image bits %u\n", argv[0], bits);
-		return 1;
+	// GPU profile
+	// the profile covers the images of the first device
+	if(status && profile && !cpu && device_images) {
+		float64_t total_time = 0.0;
+		for(uint32_t i = 0; i < BlueNoise::ProfileInitial; i++) {
+			total_time += blue_noise.getProfile((BlueNoise::ProfileStage)i).getTotalTime();
+		}
+		Log::printf("Profile: %-9s %10s %8s %12s %10s %6s\n", "stage", "count", "samples", "total ms", "mean us", "share");
+		for(uint32_t i = 0; i < BlueNoise::NumProfileStages; i++) {
+			BlueNoise::ProfileStage stage = (BlueNoise::ProfileStage)i;
+			const BlueNoise::Profile &stage_profile = blue_noise.getProfile(stage);
+			if(!stage_profile.count) continue;
+			float64_t mean_time = (stage_profile.samples) ? 1000.0 * stage_profile.time / stage_profile.samples : 0.0;
+			float64_t share = (i < BlueNoise::ProfileInitial && total_time > 0.0) ? 100.0 * stage_profile.getTotalTime() / total_time : 0.0;
+			Log::printf("Profile: %-9s %10llu %8llu %12.2f %10.2f %5.1f%%\n", BlueNoise::getProfileName(stage), (unsigned long long)stage_profile.count, (unsigned long long)stage_profile.samples, stage_profile.getTotalTime(), mean_time, share);
+		}
 	}
 	
-	// save noise image
-	if(output_name && noise_image && !noise_image.save(output_name.get())) {
-		TS_LOGF(Error, "%s: can't save output image\n", argv[0]);
+	// gather noise images
+	Array<Image> generated_images;
+	for(NoiseWorker *worker : workers) {
+		worker->stop();
+		status &= (worker->noise_images.size() == worker->input_images.size());
+	}
+	for(uint32_t i = 0; status && i < dispatch_images.size(); i++) {
+		uint32_t slot = i % devices;
+		if(slot) generated_images.append(workers[slot - 1]->noise_images[i / devices]);
+		else generated_images.append(device_images[i / devices]);
+	}
+	for(NoiseWorker *worker : workers) {
+		delete worker;
+	}
+	if(!status) {
+		TS_LOGF(Error, "%s: can't create noise\n", argv[0]);
 		return 1;
 	}
 	
-	// forward transform image
-	if(forward_name && ispot(width) && ispot(height)) {
-		Image forward_image;
-		if(layers > 1) {
+	// streamed layers
+	// the CPU generator returns whole images, so its layers are saved after the dispatch
+	if(stream) {
+		for(uint32_t i = 0; cpu && i < generated_images.size(); i++) {
 			for(uint32_t l = 0; l < layers; l++) {
-				Image forward_layer = blue_noise.dispatchForward(device, noise_image.getSlice(Layer(l)));
-				if(!forward_image && forward_layer) forward_image.create2D(forward_layer.getFormat(), forward_layer.getWidth(), forward_layer.getHeight(), layers);
-				if(forward_layer) forward_image.copy(forward_layer, Layer(l));
+				Image layer_image = (layers > 1) ? generated_images[i].getSlice(Layer(l)) : generated_images[i];
+				if(bits == 8) layer_image = layer_image.toFormat(FormatRu8n);
+				else if(bits == 16) layer_image = layer_image.toFormat(FormatRu16n);
+				if(!save_layer(i, l, layer_image)) return 1;
 			}
+		}
+		return 0;
+	}
+	
+	// merge cached images
+	Array<Image> noise_images;
+	for(uint32_t i = 0, j = 0; i < input_images.size(); i++) {
+		if(cache_images[i]) {
+			noise_images.append(cache_images[i]);
 		} else {
-			forward_image = blue_noise.dispatchForward(device, noise_image);
+			if(cache) noise_cache.save(cache_keys[i], generated_images[j]);
+			noise_images.append(generated_images[j++]);
 		}
-		if(forward_image && !forward_image.save(forward_name.get())) {
-			TS_LOGF(Error, "%s: can't save forward image\n", argv[0]);
+	}
+	Image noise_image = noise_images[0];
+	
+	// half precision quality check
+	if(check) {
+		
+		// full precision reference
+		BlueNoise reference_noise;
+		reference_noise.setTileSize(tile);
+		if(!reference_noise.create(device, width, height, layers, (BlueNoise::Flags)(flags & ~BlueNoise::FlagHalf), batch)) {
+			TS_LOGF(Error, "%s: can't create reference BlueNoise\n", argv[0]);
 			return 1;
 		}
+		reference_noise.setEnergySync(blue_noise.getEnergySync());
+		reference_noise.setEnergyRadius(blue_noise.getEnergyRadius());
+		reference_noise.setSelection(select, distance);
+		reference_noise.setOutputBits(output_bits);
+		Image reference_image = reference_noise.dispatch(device, input_image, layers, sigma, epsilon);
+		
+		// compare the first layer spectra
+		// the rank order diverges quickly, so the quality is compared in the frequency domain
+		if(reference_image && ispot(width) && ispot(height)) {
+			Image half_image = dispatch_forward((layers > 1) ? noise_image.getSlice(Layer(0)) : noise_image);
+			Image full_image = dispatch_forward((layers > 1) ? reference_image.getSlice(Layer(0)) : reference_image);
+			if(half_image && full_image) {
+				uint32_t num_low = 0;
+				float64_t half_low = 0.0, full_low = 0.0;
+				float64_t difference = 0.0, total = 0.0;
+				int32_t radius = (int32_t)min(width, height) / 8;
+				ImageSampler half_sampler(half_image);
+				ImageSampler full_sampler(full_image);
+				for(uint32_t y = 0; y < height; y++) {
+					for(uint32_t x = 0; x < width; x++) {
+						float32_t half_value = half_sampler.get2D(x, y).f.r;
+						float32_t full_value = full_sampler.get2D(x, y).f.r;
+						difference += abs(half_value - full_value);
+						total += full_value;
+						int32_t dx = (int32_t)x - (int32_t)width / 2;
+						int32_t dy = (int32_t)y - (int32_t)height / 2;
+						if((dx || dy) && dx * dx + dy * dy < radius * radius) {
+							half_low += half_value;
+							full_low += full_value;
+							num_low++;
+						}
+					}
+				}
+				Log::printf("Check: spectrum difference %.2f %% low frequency %g (%g)\n", 100.0 * difference / max(total, 1e-6), half_low / max(num_low, 1u), full_low / max(num_low, 1u));
+			}
+		}
 	}
 	
-	// forward transform X slice image
-	if(forward_x_name && layers > 1 && ispot(width) && ispot(layers)) {
+	// noise image format
+	// the device quantized images are already in the output format, the cached ranks are quantized here
+	Format output_format = (bits == 8) ? FormatRu8n : (bits == 16) ? FormatRu16n : FormatRf32;
+	for(Image &image : noise_images) {
+		if(image.getFormat() != output_format) image = image.toFormat(output_format);
+	}
+	noise_image = noise_images[0];
+	
+	// merge channels
+	// the consecutive seeded images are generated separately and merged into one output image
+	Array<Image> output_images = noise_images;
+	if(channels > 1) {
+		output_images.clear();
+		for(uint32_t i = 0; i < noise_images.size(); i += channels) {
+			Array<Image> channel_images;
+			for(uint32_t c = 0; c < channels; c++) {
+				channel_images.append(noise_images[i + c]);
+			}
+			Image channels_image = BlueNoise::mergeChannels(channel_images);
+			if(!channels_image) {
+				TS_LOGF(Error, "%s: can't merge channels\n", argv[0]);
+				return 1;
+			}
+			output_images.append(channels_image);
+		}
+	}
+	
+	// save noise images
+	// multiple images are saved with the image index before the extension
+	for(uint32_t i = 0; output_name && i < output_images.size(); i++) {
+		String name = output_name;
+		if(output_images.size() > 1) name = output_name.extension(String::format("%u.%s", i, output_name.extension().get()).get());
+		if(output_images[i] && !output_images[i].save(name.get())) {
+			TS_LOGF(Error, "%s: can't save output image\n", argv[0]);
+			return 1;
+		}
+	}
+	
+	// forward transform slices
+	// the device transforms all slices in batches, the CPU generator transforms them one by one
+	BlueNoise::Magnitude magnitude = (log_forward) ? BlueNoise::MagnitudeLog : BlueNoise::MagnitudeLinear;
+	auto dispatch_spectrum = [&](const Image &image, BlueNoise::Spectrum spectrum) -> Image {
+		if(!cpu) return blue_noise.dispatchForward(device, image, spectrum, magnitude);
+		uint32_t slice_width = (spectrum == BlueNoise::SpectrumY) ? layers : width;
+		uint32_t slice_height = (spectrum == BlueNoise::SpectrumX) ? layers : height;
+		uint32_t num_slices = (spectrum == BlueNoise::SpectrumLayers) ? layers : (spectrum == BlueNoise::SpectrumX) ? height : width;
 		Image slice_image;
 		Image forward_image;
-		slice_image.create2D(noise_image.getFormat(), width, layers);
-		for(uint32_t y = 0; y < height; y++) {
-			ImageSampler slice_sampler(slice_image);
-			for(uint32_t l = 0; l < layers; l++) {
-				ImageSampler noise_sampler(noise_image, Layer(l));
-				for(uint32_t x = 0; x < width; x++) {
-					slice_sampler.set2D(x, l, noise_sampler.get2D(x, y));
+		slice_image.create2D(image.getFormat(), slice_width, slice_height);
+		for(uint32_t i = 0; i < num_slices; i++) {
+			if(spectrum == BlueNoise::SpectrumLayers) {
+				slice_image = (layers > 1) ? image.getSlice(Layer(i)) : image;
+			} else {
+				// the slices are gathered from the raw layer rows
+				ImageSampler slice_sampler(slice_image);
+				uint8_t *slice_data = slice_sampler.getData();
+				size_t slice_stride = slice_sampler.getStride();
+				size_t pixel_size = image.getPixelSize();
+				for(uint32_t l = 0; l < layers; l++) {
+					ImageSampler noise_sampler(image, Layer(l));
+					const uint8_t *noise_data = noise_sampler.getData();
+					size_t noise_stride = noise_sampler.getStride();
+					if(spectrum == BlueNoise::SpectrumX) {
+						Memory::copy(slice_data + slice_stride * l, noise_data + noise_stride * i, pixel_size * width);
+					} else {
+						for(uint32_t y = 0; y < height; y++) Memory::copy(slice_data + slice_stride * y + pixel_size * l, noise_data + noise_stride * y + pixel_size * i, pixel_size);
+					}
 				}
 			}
-			Image forward_layer = blue_noise.dispatchForward(device, slice_image);
-			if(!forward_image && forward_layer) forward_image.create2D(forward_layer.getFormat(), forward_layer.getWidth(), forward_layer.getHeight(), height);
-			if(forward_layer) forward_image.copy(forward_layer, Layer(y));
+			Image forward_layer = dispatch_forward(slice_image);
+			if(num_slices == 1) forward_image = forward_layer;
+			else if(!forward_image && forward_layer) forward_image.create2D(forward_layer.getFormat(), forward_layer.getWidth(), forward_layer.getHeight(), num_slices);
+			if(num_slices > 1 && forward_layer) forward_image.copy(forward_layer, Layer(i));
 		}
+		for(uint32_t i = 0; log_forward && forward_image && i < num_slices; i++) {
+			ImageSampler forward_sampler = (num_slices > 1) ? ImageSampler(forward_image, Layer(i)) : ImageSampler(forward_image);
+			uint8_t *forward_data = forward_sampler.getData();
+			size_t forward_stride = forward_sampler.getStride();
+			for(uint32_t y = 0; y < forward_image.getHeight(); y++) {
+				float32_t *row = (float32_t*)(forward_data + forward_stride * y);
+				for(uint32_t x = 0; x < forward_image.getWidth(); x++) row[x] = log(1.0f + row[x]);
+			}
+		}
+		return forward_image;
+	};
+	
+	// forward transform image
+	if(forward_name && ispot(width) && ispot(height)) {
+		Image forward_image = dispatch_spectrum(noise_image, BlueNoise::SpectrumLayers);
+		if(forward_image && !forward_image.save(forward_name.get())) {
+			TS_LOGF(Error, "%s: can't save forward image\n", argv[0]);
+			return 1;
+		}
+	}
+	
+	// forward transform X slice image
+	if(forward_x_name && layers > 1 && ispot(width) && ispot(layers)) {
+		Image forward_image = dispatch_spectrum(noise_image, BlueNoise::SpectrumX);
 		if(forward_image && !forward_image.save(forward_x_name.get())) {
 			TS_LOGF(Error, "%s: can't save forward X image\n", argv[0]);
 			return 1;
@@ -238,21 +797,7 @@ int32_t main(int32_t argc, char **argv) {
 	
 	// forward transform Y slice image
 	if(forward_y_name && layers > 1 && ispot(height) && ispot(layers)) {
-		Image slice_image;
-		Image forward_image;
-		slice_image.create2D(noise_image.getFormat(), layers, height);
-		for(uint32_t x = 0; x < width; x++) {
-			ImageSampler slice_sampler(slice_image);
-			for(uint32_t l = 0; l < layers; l++) {
-				ImageSampler noise_sampler(noise_image, Layer(l));
-				for(uint32_t y = 0; y < height; y++) {
-					slice_sampler.set2D(l, y, noise_sampler.get2D(x, y));
-				}
-			}
-			Image forward_layer = blue_noise.dispatchForward(device, slice_image);
-			if(!forward_image && forward_layer) forward_image.create2D(forward_layer.getFormat(), forward_layer.getWidth(), forward_layer.getHeight(), width);
-			if(forward_layer) forward_image.copy(forward_layer, Layer(x));
-		}
+		Image forward_image = dispatch_spectrum(noise_image, BlueNoise::SpectrumY);
 		if(forward_image && !forward_image.save(forward_y_name.get())) {
 			TS_LOGF(Error, "%s: can't save forward Y image\n", argv[0]);
 			return 1;
@@ -264,17 +809,22 @@ int32_t main(int32_t argc, char **argv) {
 		Array<uint32_t> histogram;
 		if(noise_image.isFloatFormat()) histogram.resize(width * height, 0u);
 		else histogram.resize(1 << bits, 0u);
+		// the histogram is accumulated from the raw layer rows
+		float32_t scale = (float32_t)(histogram.size() - 1);
 		for(uint32_t l = 0; l < layers; l++) {
 			ImageSampler sampler(noise_image, Layer(l));
-			if(noise_image.isFloatFormat()) {
-				for(uint32_t i = 0; i < sampler.getTexels(); i++) {
-					ImageColor pixel = sampler.getTexel(i);
-					histogram[(uint32_t)((histogram.size() - 1) * pixel.f.r + 0.5f)]++;
-				}
-			} else {
-				for(uint32_t i = 0; i < sampler.getTexels(); i++) {
-					ImageColor pixel = sampler.getTexel(i);
-					histogram[pixel.u.r]++;
+			const uint8_t *data = sampler.getData();
+			size_t stride = sampler.getStride();
+			for(uint32_t y = 0; y < height; y++) {
+				const uint8_t *row = data + stride * y;
+				if(noise_image.isFloatFormat()) {
+					const float32_t *values = (const float32_t*)row;
+					for(uint32_t x = 0; x < width; x++) histogram[(uint32_t)(scale * values[x] + 0.5f)]++;
+				} else if(bits == 16) {
+					const uint16_t *values = (const uint16_t*)row;
+					for(uint32_t x = 0; x < width; x++) histogram[values[x]]++;
+				} else {
+					for(uint32_t x = 0; x < width; x++) histogram[row[x]]++;
 				}
 			}
 		}
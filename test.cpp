@@ -0,0 +1,251 @@
+// MIT License
+// 
+// Copyright (C) 2018-2023, Tellusim Technologies Inc. https://tellusim.com/
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <TellusimApp.h>
+#include <core/TellusimLog.h>
+#include <math/TellusimRandom.h>
+#include <format/TellusimImage.h>
+#include <platform/TellusimPlatforms.h>
+
+#include "BlueNoise.h"
+#include "BlueNoiseQueue.h"
+
+/*
+ */
+using namespace Tellusim;
+
+/*
+ */
+static Image create_input(uint32_t width, uint32_t height, uint32_t seed) {
+	
+	// random initial positions
+	Image input_image;
+	Random<int32_t> random(seed);
+	input_image.create2D(FormatRu8n, width, height);
+	uint8_t *input_data = input_image.getData();
+	size_t input_stride = input_image.getStride();
+	for(uint32_t i = 0; i < width * height / 10; i++) {
+		uint32_t x = random.geti32(0, width - 1);
+		uint32_t y = random.geti32(0, height - 1);
+		input_data[input_stride * y + x] = 255;
+	}
+	
+	return input_image;
+}
+
+/*
+ */
+static bool check_ranks(const Image &noise_image, uint32_t layers) {
+	
+	// every layer is a permutation of all ranks
+	uint32_t width = noise_image.getWidth();
+	uint32_t height = noise_image.getHeight();
+	uint32_t num_pixels = width * height;
+	Array<uint8_t> ranks;
+	for(uint32_t l = 0; l < layers; l++) {
+		ranks.clear();
+		ranks.resize(num_pixels, 0);
+		ImageSampler sampler(noise_image, Layer(l));
+		const uint8_t *data = sampler.getData();
+		size_t stride = sampler.getStride();
+		for(uint32_t y = 0; y < height; y++) {
+			const float32_t *row = (const float32_t*)(data + stride * y);
+			for(uint32_t x = 0; x < width; x++) {
+				uint32_t rank = (uint32_t)(row[x] * (num_pixels - 1) + 0.5f);
+				if(rank >= num_pixels || ranks[rank]) {
+					TS_LOGF(Error, "check_ranks(): duplicate %u rank at %ux%u of %u layer\n", rank, x, y, l);
+					return false;
+				}
+				ranks[rank] = 1;
+			}
+		}
+	}
+	
+	return true;
+}
+
+/*
+ */
+static bool test_unique_ranks(const Device &device, uint32_t width, uint32_t height, uint32_t layers, BlueNoise::Flags flags = BlueNoise::DefaultFlags, uint32_t select = 1) {
+	
+	// the size is not a multiple of the group size, so the edge groups are partially outside the texture
+	BlueNoise blue_noise;
+	if(!blue_noise.create(device, width, height, layers, flags)) {
+		TS_LOG(Error, "test_unique_ranks(): can't create BlueNoise\n");
+		return false;
+	}
+	
+	// the separated selection runs out of candidates at the end of the phases
+	blue_noise.setSelection(select, 3.0f);
+	
+	Image noise_image = blue_noise.dispatch(device, create_input(width, height, 1), layers, 2.0f, 0.01f);
+	if(!noise_image) {
+		TS_LOG(Error, "test_unique_ranks(): can't create noise\n");
+		return false;
+	}
+	
+	return check_ranks(noise_image, layers);
+}
+
+/*
+ */
+static bool test_convergence(const Device &device, uint32_t width, uint32_t height) {
+	
+	// the fixed batch size keeps the exit bound
+	BlueNoise blue_noise;
+	if(!blue_noise.create(device, width, height, 1)) {
+		TS_LOG(Error, "test_convergence(): can't create BlueNoise\n");
+		return false;
+	}
+	blue_noise.setStatistics(true);
+	
+	// the ranks below the number of positions are the converged initial pattern
+	Image input_image = create_input(width, height, 1);
+	Image noise_image = blue_noise.dispatch(device, input_image, 1, 2.0f, 0.01f);
+	if(!noise_image) {
+		TS_LOG(Error, "test_convergence(): can't create noise\n");
+		return false;
+	}
+	uint32_t num_pixels = width * height;
+	uint32_t num_positions = 0;
+	const uint8_t *input_data = input_image.getData();
+	size_t input_stride = input_image.getStride();
+	for(uint32_t y = 0; y < height; y++) {
+		for(uint32_t x = 0; x < width; x++) {
+			num_positions += (input_data[input_stride * y + x] > 127);
+		}
+	}
+	Image converged_image;
+	converged_image.create2D(FormatRu8n, width, height);
+	uint8_t *converged_data = converged_image.getData();
+	size_t converged_stride = converged_image.getStride();
+	const uint8_t *noise_data = noise_image.getData();
+	size_t noise_stride = noise_image.getStride();
+	for(uint32_t y = 0; y < height; y++) {
+		const float32_t *noise_row = (const float32_t*)(noise_data + noise_stride * y);
+		for(uint32_t x = 0; x < width; x++) {
+			uint32_t rank = (uint32_t)(noise_row[x] * (num_pixels - 1) + 0.5f);
+			converged_data[converged_stride * y + x] = (rank < num_positions) ? 255 : 0;
+		}
+	}
+	
+	// the converged pattern is detected in the first batch and read back after the second one
+	noise_image = blue_noise.dispatch(device, converged_image, 1, 2.0f, 0.01f);
+	if(!noise_image) {
+		TS_LOG(Error, "test_convergence(): can't create converged noise\n");
+		return false;
+	}
+	uint64_t iterations = blue_noise.getStatistics(BlueNoise::PhaseInitial).iterations;
+	uint64_t max_iterations = (uint64_t)blue_noise.getBatchSize() * 2;
+	if(max_iterations >= num_positions) {
+		TS_LOGF(Error, "test_convergence(): %u positions are not enough for the %llu iterations bound\n", num_positions, (unsigned long long)max_iterations);
+		return false;
+	}
+	if(iterations > max_iterations) {
+		TS_LOGF(Error, "test_convergence(): %llu initial iterations are more than %llu\n", (unsigned long long)iterations, (unsigned long long)max_iterations);
+		return false;
+	}
+	
+	return check_ranks(noise_image, 1);
+}
+
+/*
+ */
+static bool test_queue(PlatformType platform, uint32_t index) {
+	
+	// create request queue
+	BlueNoiseQueue queue;
+	if(!queue.create(platform, index)) {
+		TS_LOG(Error, "test_queue(): can't create BlueNoiseQueue\n");
+		return false;
+	}
+	
+	// submit requests
+	// the second request is canceled before its first batch is finished
+	BlueNoiseQueue::Parameters parameters;
+	uint32_t id_0 = queue.submit(Array<Image>({ create_input(64, 64, 1) }), parameters);
+	parameters.layers = 4;
+	uint32_t id_1 = queue.submit(Array<Image>({ create_input(256, 256, 2) }), parameters);
+	if(!id_0 || !id_1) {
+		TS_LOG(Error, "test_queue(): can't submit requests\n");
+		return false;
+	}
+	queue.cancel(id_1);
+	
+	// the canceled request returns no images
+	Array<Image> canceled_images = queue.wait(id_1);
+	if(canceled_images) {
+		TS_LOG(Error, "test_queue(): canceled request returned images\n");
+		return false;
+	}
+	
+	// the other request is finished
+	Array<Image> noise_images = queue.wait(id_0);
+	if(noise_images.size() != 1) {
+		TS_LOG(Error, "test_queue(): can't get request images\n");
+		return false;
+	}
+	if(queue.getState(id_0) != BlueNoiseQueue::StateUnknown) {
+		TS_LOG(Error, "test_queue(): request is not released\n");
+		return false;
+	}
+	
+	return check_ranks(noise_images[0], 1);
+}
+
+/*
+ */
+int32_t main(int32_t argc, char **argv) {
+	
+	// initialize application
+	App app(argc, argv);
+	
+	// create context
+	Context context(app.getPlatform(), app.getDevice());
+	if(!context || !context.create()) {
+		TS_LOGF(Error, "%s: can't create context\n", argv[0]);
+		return 1;
+	}
+	
+	// create device
+	Device device(context);
+	if(!device.hasShader(Shader::TypeCompute)) {
+		TS_LOGF(Error, "%s: compute shader is not supported\n", argv[0]);
+		return 1;
+	}
+	Log::printf("Platform: %s Device: %s\n", device.getPlatformName(), device.getName().get());
+	
+	// run tests
+	uint32_t num_failed = 0;
+	auto run_test = [&](const char *name, bool status) {
+		Log::printf("%s: %s\n", name, (status) ? "passed" : "failed");
+		if(!status) num_failed++;
+	};
+	run_test("unique ranks 100x90", test_unique_ranks(device, 100, 90, 1));
+	run_test("unique ranks 90x100 layers 2", test_unique_ranks(device, 90, 100, 2));
+	run_test("unique ranks 100x90 select 8", test_unique_ranks(device, 100, 90, 1, BlueNoise::DefaultFlags, 8));
+	run_test("unique ranks 128x128 select 16 incremental", test_unique_ranks(device, 128, 128, 1, BlueNoise::FlagIncremental, 16));
+	run_test("initial convergence 256x256", test_convergence(device, 256, 256));
+	run_test("queue cancel", test_queue(app.getPlatform(), app.getDevice()));
+	
+	return (num_failed) ? 1 : 0;
+}